@@ -0,0 +1,104 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <deque>
+#include <memory>
+#include "Instruction.h"
+
+class CPU;
+class MMU;
+
+//an instruction decoded once: a handler with its register operands bound
+//and its immediate already pulled out of the instruction stream
+struct DecodedOp {
+    using Handler = void(*)(CPU& cpu, const DecodedOp& op);
+    Handler execute = nullptr;
+    uint8_t* r1 = nullptr;
+    uint8_t* r2 = nullptr;
+    uint8_t* r3 = nullptr;
+    Operation::MathOp math = nullptr;
+    Operation::RotFunc rot = nullptr;
+    Operation::ConditionCheck cc = nullptr;
+    uint16_t imm = 0;       //n8, n16 or e8 operand
+    uint8_t arg = 0;        //bit index or rst vector
+    uint8_t length = 1;     //bytes, including opcode and prefix
+    bool ends_block = false;
+    uint16_t opcode = 0;    //0xCBxx for prefixed ops
+};
+
+//a block that jumps back to its own start and only reads memory
+//once a pass leaves the registers as it found them, every further pass does
+//the same until something it reads changes, see CPU::skip_idle_loop
+struct IdleLoop {
+    static constexpr int MAX_READS = 4;
+    //register each read address comes from, as it is at the loop start
+    enum class Base : uint8_t {ABSOLUTE, HL, BC, DE, HIGH_C};
+    struct Read {
+        Base base = Base::ABSOLUTE;
+        uint16_t addr = 0;
+    };
+    bool candidate = false;
+    uint8_t read_count = 0;
+    std::array<Read, MAX_READS> reads;
+};
+
+//straight-line code up to the next jump, call, return, halt or ei
+struct Block {
+    std::vector<DecodedOp> ops;
+    bool valid = false;     //cleared when the memory it was decoded from changes
+    IdleLoop idle;
+
+    //native translation, see Jit
+    void (*native)() = nullptr;
+    int slot = -1;          //arena slot last used for this block
+    unsigned hits = 0;
+};
+
+//decoded blocks keyed by (rom bank, pc)
+//rom never changes, so only bank switches matter there; blocks decoded
+//from wram or hram are dropped when the cpu writes to their page
+class BlockCache {
+public:
+    static constexpr size_t MAX_BLOCK_OPS = 64;
+private:
+    MMU& mmu;
+
+    std::array<DecodedOp, 0x100> base_ops;      //per opcode, operands bound
+    std::array<DecodedOp, 0x100> cb_ops;
+
+    std::deque<Block> storage;                  //stable addresses
+    std::array<Block*, 0x10000> fixed{};        //blocks outside the switchable bank
+    std::vector<std::unique_ptr<std::array<Block*, 0x4000>>> banked;   //per rom bank
+    Block* running_banked = nullptr;            //last block handed out from 4000-7FFF
+
+    std::array<bool, 0x100> watched{};          //pages that blocks were decoded from
+    std::array<std::vector<Block*>, 0x100> page_blocks;
+
+    void build_tables(CPU& cpu);
+    Block** slot(uint16_t pc);
+    void decode(Block& block, uint16_t pc);
+    void watch(Block& block, uint16_t first, uint16_t last);
+    void set_watch(uint8_t page, bool on);
+    void invalidate(uint16_t addr);
+public:
+    BlockCache(CPU& cpu, MMU& mmu);
+
+    //block starting at pc, decoded on first use
+    //nullptr if code at pc is not cached and must go through the interpreter
+    Block* lookup(uint16_t pc);
+
+    //pages whose writes have to reach written(), indexed by addr >> 8
+    const bool* watched_pages() const {return watched.data();}
+
+    //every cpu write passes through here
+    void written(uint16_t addr) {
+        if(watched[addr >> 8]) {
+            invalidate(addr);
+        }
+    }
+};
+
+#endif
@@ -6,25 +6,50 @@
 #include <memory>
 #include <string>
 #include <iostream>
+#include "Arithmetic.h"
 #include "Instruction.h"
+#include "BlockCache.h"
 #include "Memory/Bus.h"
 
 class MMU;
 class Instruction;
 class InterruptController;
+class Jit;
 enum class Interrupt : uint8_t;
 
 enum class Flag {
     CARRY = 4, HALF_CARRY, NEGATIVE, ZERO
 };
 
+namespace ConditionCode {
+    inline bool NZ(const uint8_t& f) {return !Arithmetic::bit_check(f, (int)Flag::ZERO);}
+    inline bool Z (const uint8_t& f) {return  Arithmetic::bit_check(f, (int)Flag::ZERO);}
+    inline bool NC(const uint8_t& f) {return !Arithmetic::bit_check(f, (int)Flag::CARRY);}
+    inline bool C (const uint8_t& f) {return  Arithmetic::bit_check(f, (int)Flag::CARRY);}
+    inline bool ALWAYS(const uint8_t& f) {return true;}
+}
+
 class CPU {
 public: //methods
     CPU(Bus& bus, MMU& mmu, InterruptController& ih);
     ~CPU();
     
     //cpu clocked in m-cycles (1 m-cycle = 4 t-states)
+    //runs one instruction, interrupt dispatch or halted cycle through the
+    //reference switch interpreter
     void tick();
+    //run until the bus reaches the given m-cycle
+    void run(unsigned long until);
+
+    //the switch interpreter is the reference; cached blocks are the default
+    //jit translates hot rom blocks on top of the cached engine and falls back
+    //to it on hosts without a code generator
+    enum class Engine {INTERPRETER, CACHED, JIT};
+    void set_engine(Engine e);
+
+    void code_written(uint16_t addr) {blocks.written(addr);}
+    //pages a write must not skip code_written() on
+    const bool* code_pages() const {return blocks.watched_pages();}
 
     void idle_m_cycle() { bus.cycle(); }
 
@@ -33,13 +58,50 @@ public: //methods
     uint8_t fetch_byte();
 
     void set_flag(Flag fl, bool val) {
+        sync_flags();
         F = (F & ~((uint8_t)1 << (int)fl)) | ((uint8_t)val << (int)fl);
     }
-    bool get_flag(Flag fl) const {
+    bool get_flag(Flag fl) {
+        if(fl == Flag::CARRY) {
+            return carry_flag();
+        }
+        sync_flags();
         return (F >> (int)fl) & (uint8_t)1;
     }
 
-    void prefix_mode() {cb_mode = true;}
+    //lazy flags: 8-bit add/sub/inc/dec record their operands and F is only
+    //rebuilt when something reads it
+    //ADD and SUB take a carry in (adc, sbc); INC and DEC keep the old carry
+    enum class FlagOp : uint8_t {NONE, ADD, SUB, INC, DEC};
+    void defer_flags(FlagOp op, uint8_t lhs, uint8_t rhs, bool carry) {
+        lazy = {op, lhs, rhs, carry};
+    }
+    //overwrite all four flags
+    void set_flags(uint8_t f) {
+        F = f;
+        lazy.op = FlagOp::NONE;
+    }
+    void sync_flags() {
+        if(lazy.op != FlagOp::NONE) {
+            materialize_flags();
+        }
+    }
+    uint8_t flags() {
+        sync_flags();
+        return F;
+    }
+    //carry alone, without rebuilding F
+    bool carry_flag() const {
+        switch(lazy.op) {
+            case FlagOp::ADD: return lazy.lhs + lazy.rhs + lazy.carry > 0xFF;
+            case FlagOp::SUB: return lazy.rhs + lazy.carry > lazy.lhs;
+            case FlagOp::INC:
+            case FlagOp::DEC: return lazy.carry;
+            default: return (F >> (int)Flag::CARRY) & (uint8_t)1;
+        }
+    }
+
+    void execute_prefixed() {execute_cb(fetch_byte());}
     void halt();
     void schedule_ei() {ei_scheduled = true;}
 
@@ -48,25 +110,69 @@ public: //data
     uint16_t pc;    
     uint16_t sp;
     //data registers
+    //F may be stale while a lazy flag op is pending, read it through flags()
     uint8_t A, B, C, D, E, H, L, F;
     bool IME = false;
 private:
     using StateFunction = void (CPU::*)();  //pointer to state function
 
-    int cycles;
+    int cycles = 0;
+
+    struct LazyFlags {
+        FlagOp op = FlagOp::NONE;
+        uint8_t lhs = 0;
+        uint8_t rhs = 0;
+        bool carry = false;
+    };
+    LazyFlags lazy;
+    void materialize_flags();
 
     void service_interrupt(Interrupt irq);
     void execute(uint8_t opcode);
     void execute_cb(uint8_t opcode);
-    bool halted;
+    void run_block(const Block& block, unsigned long until);
+    bool skip_halt(unsigned long until);
+
+    //the last arrival at the start of an idle loop candidate
+    struct LoopVisit {
+        const Block* block = nullptr;
+        std::array<uint8_t, 8> regs{};
+        uint16_t sp = 0;
+        bool ime = false;
+        unsigned long at = 0;
+        unsigned long horizon = 0;  //reads were stable until here
+    };
+    LoopVisit visit;
+    bool skip_idle_loop(const Block& block, unsigned long until);
+    bool halted = false;
 
-    bool cb_mode = false;
     bool halt_bug = false;
     bool ei_scheduled = false;
 
     //facilities
     Bus& bus;
+    MMU& mmu;
     InterruptController& interrupt_controller;
+
+    Engine engine = Engine::CACHED;
+    BlockCache blocks;
+    std::unique_ptr<Jit> jit;   //created on first switch to Engine::JIT
+
+public: //snapshots
+    //registers and what the engines carry from one instruction to the
+    //next; decoded and translated code is not saved, code_written() drops
+    //whatever a restore changes under it
+    struct Snapshot {
+        uint16_t pc, sp;
+        uint8_t A, B, C, D, E, H, L, F;
+        bool IME;
+        int cycles;
+        LazyFlags lazy;
+        LoopVisit visit;
+        bool halted, halt_bug, ei_scheduled;
+    };
+    void save_state(Snapshot& state) const;
+    void load_state(const Snapshot& state);
 };
 
 #endif
@@ -9,10 +9,15 @@
 #include "Memory/Spaces.h"
 #include "Graphics/PPU.h"
 #include "Graphics/LCD.h"
+#include "Graphics/HeadlessLCD.h"
 #include "Control/Joypad.h"
 #include "Control/InputHandler.h"
+#include "Control/HeadlessInput.h"
 #include "CPU.h"
 #include "Timer.h"
+#include <memory>
+#include <array>
+#include <algorithm>
 
 class Console {
 public:
@@ -32,10 +37,12 @@ public:
     Timer tim;
 
     //externals
-    InputHandler ih;
-    LCD display;
+    std::unique_ptr<InputHandler> ih;
+    std::unique_ptr<LCD> display;
 
-    Console() 
+    static constexpr unsigned long FRAME_CYCLES = 17556;
+
+    Console(std::unique_ptr<LCD> screen, std::unique_ptr<InputHandler> input)
     :bus{}, 
      mmu{bus},    
      ic{mmu},     
@@ -48,15 +55,102 @@ public:
      jp{bus, mmu, ic},
      tim{bus, mmu, ic},
 
-     ih{},
-     display{3}
+     ih{std::move(input)},
+     display{std::move(screen)}
     {
         mmu.map_region(Space::WRAM_START, Space::WRAM_END, wram.data());
         mmu.map_region(Space::ECHO_RAM_START, Space::ECHO_RAM_END, wram.data());    //echo ram
 
-        ppu.connect_display(&display);
-        jp.connect_input_handler(&ih);
+        ppu.connect_display(display.get());
+        jp.connect_input_handler(ih.get());
+
+        //plan the first ppu and timer events
+        bus.sync();
+    }
+
+    //headless console; no window, no SDL
+    Console()
+    :Console{std::make_unique<HeadlessLCD>(), std::make_unique<HeadlessInput>()} {}
+
+    //draw = false runs the frame exactly the same, but leaves the screen
+    //as it was; a frame's worth of cycles covers every line once
+    void run_frame(bool draw = true) {
+        //run the cpu for one frame's worth of m-cycles
+        ppu.set_render_skip(!draw);
+        next_frame_target += FRAME_CYCLES;
+        cpu.run(next_frame_target);
+        //finish the frame's pending dots before it is presented
+        bus.sync();
     }
+
+    //the whole machine in memory, for going back in time; only for the
+    //console that took it, with the same cart loaded. the screen and the
+    //settings (cpu engine, renderer, render skip) are not part of it
+    struct Snapshot {
+        Bus::Snapshot bus;
+        MMU::Snapshot mmu;
+        std::array<uint8_t, 0x2000> wram;
+        Cart::Snapshot rom;
+        CPU::Snapshot cpu;
+        PPU::Snapshot ppu;
+        JoyPad::Snapshot jp;
+        Timer::Snapshot tim;
+        unsigned long next_frame_target;
+    };
+    void save_state(Snapshot& state) const {
+        bus.save_state(state.bus);
+        mmu.save_state(state.mmu);
+        state.wram = wram;
+        rom.save_state(state.rom);
+        cpu.save_state(state.cpu);
+        ppu.save_state(state.ppu);
+        jp.save_state(state.jp);
+        tim.save_state(state.tim);
+        state.next_frame_target = next_frame_target;
+    }
+    void load_state(const Snapshot& state) {
+        //code cached from ram the snapshot changes has to be decoded again
+        for(uint16_t page = 0; page < wram.size(); page += 0x100) {
+            if(!std::equal(wram.begin() + page, wram.begin() + page + 0x100, state.wram.begin() + page)) {
+                cpu.code_written(Space::WRAM_START + page);
+            }
+        }
+        const uint8_t* hram = &mmu.io_register(Space::HRAM_START);
+        if(!std::equal(hram, hram + (Space::HRAM_END - Space::HRAM_START + 1), &state.mmu.high[Space::HRAM_START & 0xFF])) {
+            cpu.code_written(Space::HRAM_START);
+        }
+        bus.load_state(state.bus);
+        mmu.load_state(state.mmu);     //before the ppu, which reads its palettes from it
+        wram = state.wram;
+        rom.load_state(state.rom);
+        cpu.load_state(state.cpu);
+        ppu.load_state(state.ppu);
+        jp.load_state(state.jp);
+        tim.load_state(state.tim);
+        next_frame_target = state.next_frame_target;
+    }
+
+    //runs a frame with the screen left alone, then frames more from a
+    //snapshot that is thrown away again, drawing only the last; the
+    //screen shows the game frames ahead of where it is, so input read
+    //before the call shows that many frames sooner, at frames + 1 times
+    //the work. with 0 frames or nothing to draw it is just run_frame
+    void run_ahead(unsigned int frames, bool draw = true) {
+        if(frames == 0 || !draw) {
+            run_frame(draw);
+            return;
+        }
+        run_frame(false);
+        save_state(ahead);
+        for(unsigned int i = 1; i <= frames; ++i) {
+            run_frame(draw && i == frames);
+        }
+        load_state(ahead);
+    }
+
+private:
+    unsigned long next_frame_target = 0;
+    Snapshot ahead;     //kept so run_ahead never allocates
 };
 
 #endif
\ No newline at end of file
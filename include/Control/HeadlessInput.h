@@ -0,0 +1,30 @@
+#ifndef HEADLESSINPUT_H
+#define HEADLESSINPUT_H
+
+#include "InputHandler.h"
+
+class HeadlessInput : public InputHandler {
+//programmatic input source for batch runs and bots
+private:
+    uint8_t pressed = 0;   //one bit per button
+    uint8_t latched = 0;   //state seen by the joypad this frame
+
+    static uint8_t mask(Mapping key) {
+        return (uint8_t)1 << static_cast<uint8_t>(key);
+    }
+
+public:
+    void press(Mapping key)   {pressed |= mask(key);}
+    void release(Mapping key) {pressed &= ~mask(key);}
+    void set_buttons(uint8_t state) {pressed = state;}
+    uint8_t buttons() const {return pressed;}
+
+    void get_key_state() override {
+        latched = pressed;
+    }
+    bool key_pressed(Mapping key) override {
+        return latched & mask(key);
+    }
+};
+
+#endif
@@ -1,28 +1,20 @@
-#include "SDL2/SDL.h"
+#ifndef INPUTHANDLER_H
+#define INPUTHANDLER_H
 
-class JoyPad;
+#include <cstdint>
 
 class InputHandler {
-private:
-    const Uint8* key_state;
-
+//abstract input source polled by the joypad once per frame
 public:
-    //button mappings
-    enum class Mapping : Uint8 {
-        LEFT   = SDL_SCANCODE_A,
-        RIGHT  = SDL_SCANCODE_D,
-        DOWN   = SDL_SCANCODE_S,
-        UP     = SDL_SCANCODE_W,
-        A      = SDL_SCANCODE_L,
-        B      = SDL_SCANCODE_K,
-        START  = SDL_SCANCODE_RETURN,
-        SELECT = SDL_SCANCODE_SPACE,
+    //gameboy buttons
+    enum class Mapping : uint8_t {
+        LEFT, RIGHT, DOWN, UP, A, B, START, SELECT,
     };
 
-    void get_key_state() {
-        key_state = SDL_GetKeyboardState(NULL);
-    }
-    bool key_pressed(Mapping key) {
-        return key_state[static_cast<SDL_Scancode>(key)];
-    }
-};  
\ No newline at end of file
+    virtual ~InputHandler() = default;
+
+    virtual void get_key_state() = 0;
+    virtual bool key_pressed(Mapping key) = 0;
+};
+
+#endif
@@ -10,8 +10,10 @@ class Bus;
 
 class JoyPad : public IO {
 private:
-    //memory-mapped joypad register
+    //select bits last written to P1
     uint8_t data;   
+    //P1 as the cpu reads it, kept current in the mmu's register file
+    uint8_t& output;
 
     InterruptController& ic;
 
@@ -19,6 +21,8 @@ private:
 
     uint8_t dpad_state;
     uint8_t button_state;
+
+    uint8_t state() const;
 public:
     static constexpr uint16_t ADDRESS = 0xFF00;
     JoyPad(Bus& bus, MMU& mmu, InterruptController& ic);
@@ -29,15 +33,27 @@ public:
 
     void read_input();
 
-    bool buttons_enabled() {
+    bool buttons_enabled() const {
         return !((data >> 5) & (uint8_t)1);
     }
-    bool dpad_enabled() {
+    bool dpad_enabled() const {
         return !((data >> 4) & (uint8_t)1);
     }
 
-    uint8_t read(uint16_t addr) override;
     void write(uint16_t addr, uint8_t val) override; 
+
+    //P1 itself is saved with the register file
+    struct Snapshot {
+        uint8_t data;
+        uint8_t dpad_state;
+        uint8_t button_state;
+    };
+    void save_state(Snapshot& state) const {state = {data, dpad_state, button_state};}
+    void load_state(const Snapshot& state) {
+        data = state.data;
+        dpad_state = state.dpad_state;
+        button_state = state.button_state;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef SDLINPUTHANDLER_H
+#define SDLINPUTHANDLER_H
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include "InputHandler.h"
+
+class SdlInputHandler : public InputHandler {
+//keyboard backend
+//SDL keeps the keyboard state up to date on the thread that pumps events,
+//so the main thread samples it there and the joypad latches the sample
+private:
+    std::atomic<uint8_t> pressed{0};    //one bit per button
+    uint8_t latched = 0;                //state seen by the joypad this frame
+
+    static constexpr Mapping buttons[] = {
+        Mapping::LEFT, Mapping::RIGHT, Mapping::DOWN, Mapping::UP,
+        Mapping::A, Mapping::B, Mapping::START, Mapping::SELECT,
+    };
+    static uint8_t mask(Mapping key) {
+        return (uint8_t)1 << static_cast<uint8_t>(key);
+    }
+    static SDL_Scancode scancode(Mapping key) {
+        //button mappings
+        switch(key) {
+            case Mapping::LEFT  : return SDL_SCANCODE_A;
+            case Mapping::RIGHT : return SDL_SCANCODE_D;
+            case Mapping::DOWN  : return SDL_SCANCODE_S;
+            case Mapping::UP    : return SDL_SCANCODE_W;
+            case Mapping::A     : return SDL_SCANCODE_L;
+            case Mapping::B     : return SDL_SCANCODE_K;
+            case Mapping::START : return SDL_SCANCODE_RETURN;
+            case Mapping::SELECT: return SDL_SCANCODE_SPACE;
+            default: return SDL_SCANCODE_UNKNOWN;
+        }
+    }
+
+public:
+    //main thread, after pumping events
+    void sample() {
+        const Uint8* key_state = SDL_GetKeyboardState(NULL);
+        uint8_t state = 0;
+        for(Mapping key : buttons) {
+            if(key_state[scancode(key)]) {
+                state |= mask(key);
+            }
+        }
+        pressed.store(state, std::memory_order_relaxed);
+    }
+
+    //emulation thread
+    void get_key_state() override {
+        latched = pressed.load(std::memory_order_relaxed);
+    }
+    bool key_pressed(Mapping key) override {
+        return latched & mask(key);
+    }
+};
+
+#endif
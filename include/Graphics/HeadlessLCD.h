@@ -0,0 +1,16 @@
+#ifndef HEADLESSLCD_H
+#define HEADLESSLCD_H
+
+#include "LCD.h"
+
+class HeadlessLCD : public LCD {
+//display-less backend; completed frames stay in the buffer
+//until the next one overwrites them
+private:
+    unsigned long frames = 0;
+public:
+    void draw_frame() override {frames++;}
+    unsigned long frame_count() const {return frames;}
+};
+
+#endif
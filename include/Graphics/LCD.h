@@ -2,14 +2,24 @@
 #define LCD_H
 
 #include <cstdint>
-#include <array>
-#include <memory>
-#include <SDL2/SDL.h>  
+#include <cstddef>
+#include <vector>
+#include <bitset>
 
 class LCD {
-private:
-    using PixelFormat = uint32_t;
+//abstract frame sink
+//the PPU blits pixels into the frame buffer; backends decide what
+//to do with a completed frame (present it, hash it, drop it...)
+public:
+    //how the frame buffer stores a pixel
+    enum class Format : uint8_t {
+        SHADE,          //one byte per pixel, the shade (0-3)
+        SHADE_2BPP,     //4 shades per byte, leftmost pixel in the top bits
+        RGB565,         //uint16_t per pixel
+        ARGB8888,       //uint32_t per pixel
+    };
 
+protected:
     static constexpr unsigned int SCREEN_HEIGHT = 144;
     static constexpr unsigned int SCREEN_WIDTH  = 160;
 
@@ -20,31 +30,56 @@ private:
         BLACK = 0xFF000000,
     };
 
-    std::array<PixelFormat, SCREEN_WIDTH * SCREEN_HEIGHT> buffer;
-    unsigned int scale;
+    Format pixel_format = Format::ARGB8888;
+    std::vector<uint8_t> buffer = std::vector<uint8_t>(frame_bytes(Format::ARGB8888));
     uint32_t color_palette[4] = {
         WHITE, LIGHT_GRAY, DARK_GRAY, BLACK
     };
-    
+
+    //where the ppu draws: buffer, unless a backend hands it memory of its
+    //own to skip copying frames there later
+    uint8_t* target = buffer.data();
+    //the frame before, if target did not start out as a copy of it; lines
+    //the ppu leaves partly or wholly undrawn are completed from it
+    const uint8_t* previous = nullptr;
+    std::bitset<SCREEN_HEIGHT> drawn;   //lines of target holding this frame
+    void retarget(uint8_t* frame, const uint8_t* previous_frame);
+    //copies the lines the ppu did not draw from the previous frame
+    void complete_frame();
+
 public:
-    LCD(unsigned int window_scale);
+    virtual ~LCD() = default;
+
+    //switching format clears the frame
+    virtual void set_format(Format format);
+    Format format() const {return pixel_format;}
+    static constexpr size_t line_bytes(Format format) {
+        switch(format) {
+            case Format::SHADE:      return SCREEN_WIDTH;
+            case Format::SHADE_2BPP: return SCREEN_WIDTH / 4;
+            case Format::RGB565:     return SCREEN_WIDTH * 2;
+            case Format::ARGB8888:   return SCREEN_WIDTH * 4;
+        }
+        return 0;
+    }
+    static constexpr size_t frame_bytes(Format format) {return SCREEN_HEIGHT * line_bytes(format);}
 
-    void init();
-    void blit(uint8_t px, uint8_t x, uint8_t y) {
-        buffer[y * SCREEN_WIDTH + x] = color_palette[px];
-    } 
-    void draw_frame();
+    //marks a pixel blit_line leaves as it was
+    static constexpr uint8_t KEEP = 0xFF;
+    //converts a whole line of shades (0-3), one byte per pixel, to the
+    //frame's format
+    void blit_line(const uint8_t* shades, uint8_t y);
+    //the ppu entered vblank with at least one line drawn since the last
+    //one; runs on the emulation thread
+    virtual void frame_ready() {}
+    virtual void draw_frame() = 0;
     constexpr int width() const {return SCREEN_WIDTH;}
     constexpr int height() const {return SCREEN_HEIGHT;}
 
-private:
-    using WindowPtr   = std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)>;
-    using RendererPtr = std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)>;
-    using TexturePtr  = std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)>;
-    
-    WindowPtr window{nullptr, SDL_DestroyWindow};
-    RendererPtr renderer{nullptr, SDL_DestroyRenderer};
-    TexturePtr texture{nullptr, SDL_DestroyTexture};
+    //raw frame buffer: height() lines of pitch() bytes
+    const uint8_t* frame() const {return target;}
+    size_t pitch() const {return line_bytes(pixel_format);}
+    size_t frame_bytes() const {return buffer.size();}
 };
 
-#endif
\ No newline at end of file
+#endif
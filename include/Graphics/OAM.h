@@ -3,6 +3,7 @@
 
 #include <array>
 #include <cstdint>
+#include <algorithm>
 #include "Sprite.h"
 #include "Memory/MMU.h" 
 
@@ -10,13 +11,14 @@ class MMU;
 
 class OAM {
 private:
-    std::array<uint8_t, 0x100> container;
-    bool accessible = true;
+    std::array<uint8_t, 0x100> container{};
 public:
     static constexpr uint16_t START = 0xFE00;
     static constexpr uint16_t END   = 0xFEFF; //padded to fill page
 
     OAM(MMU& mmu) {
+        //the unusable tail reads as open bus; the mmu never writes it
+        std::fill(container.begin() + (Space::OAM_RESERVED_START - START), container.end(), 0xFF);
         mmu.map_region(START, END, container.data());
     } 
     uint8_t read(uint16_t addr) const {
@@ -25,22 +27,25 @@ public:
     void write(uint16_t addr, uint8_t val) {
         container[addr-START] = val;
     }
+    //dma target; the sprite table is the first 160 bytes
+    uint8_t* table() {
+        return container.data();
+    }
     Sprite sprite_at(uint16_t addr) {
         return Sprite{&container[addr - START]};
     }
 
+    //snapshots
+    using Snapshot = std::array<uint8_t, 0x100>;
+    void save_state(Snapshot& state) const {state = container;}
+    void load_state(const Snapshot& state) {container = state;}
+
     void block(MMU& mmu) {
-        if(accessible) {
-            accessible = false;
-            mmu.unmap_region(START, END);
-        }
+        mmu.lock(MMU::OAM_LOCK);
     }
     
     void unblock(MMU& mmu) {
-        if(!accessible) {
-            mmu.map_region(START, END, container.data());
-            accessible = true;
-        }
+        mmu.unlock(MMU::OAM_LOCK);
     }
 };  
 
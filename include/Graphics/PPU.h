@@ -30,10 +30,17 @@ private:
     SpriteBuffer spr_buf;
     BgFifo bg_fifo;
     SprFifo spr_fifo;
-    uint8_t scanline_x;     //position on screen (0-159)
-    uint8_t oam_counter;
-    LCD* screen;
-    bool in_window;
+    uint8_t scanline_x = 0;     //position on screen (0-159)
+    //shades of the line being drawn, handed to the screen in one go when
+    //mode 3 ends; the fifo leaves LCD::KEEP where it draws nothing
+    std::array<uint8_t, 256> line{};
+    void flush_line();
+    bool render_skip = false;
+    bool line_drawn = true;     //render_skip as latched when mode 3 starts
+    bool frame_drawn = false;   //a line reached the screen since the last vblank
+    uint8_t oam_counter = 0;
+    LCD* screen = nullptr;
+    bool in_window = false;
     void check_window_transition();
     uint8_t sprite_triggered() const;
 
@@ -42,15 +49,45 @@ private:
     void prep_scanline();
     void advance_scanline();
 
-    int cycles;
+    int cycles = 0;
     InterruptController& ic;
     EdgeDetector stat_trigger;
 
+    //lazy clocking: the ppu only runs when synced by the bus
+    Bus& bus;
+    unsigned long synced = 0;   //bus m-cycle the ppu has caught up to
+    long next_event_dots() const;
+
     //PPU states
-    void oam_scan();
-    void pixel_transfer();
-    void h_blank();
-    void v_blank();
+    //each runs up to budget dots and returns how many it ran
+    unsigned long oam_scan(unsigned long budget);
+    unsigned long pixel_transfer(unsigned long budget);
+    unsigned long h_blank(unsigned long budget);
+    unsigned long v_blank(unsigned long budget);
+    void pixel_transfer_dot();
+    bool fifo_dot();    //returns true once the line is done
+
+    //scanline renderer
+    int transfer_end = 0;       //dot the current line's mode 3 ends on, 0 while the fetchers time it
+    uint8_t line_scx = 0;       //scroll as the fifo latches it when mode 3 starts
+    uint8_t line_scy = 0;
+    bool window_on_line() const;
+    //what can stall the fifo's fetchers on a line
+    struct FetchStalls {
+        std::array<uint8_t, 10> spr_x{};
+        uint8_t spr_count = 0;
+        bool obj_enable = false;
+        int win_x = -1;     //-1 without a window on the line
+        bool operator==(const FetchStalls&) const = default;
+    };
+    FetchStalls fetch_stalls() const;
+    FetchStalls timed_stalls;   //stalls of the last line the fetchers were stepped through
+    int timed_dots = 0;         //mode 3 length they gave, 0 if it can't be reused
+    int scanline_transfer_dots();
+    PixelFetcher::Snapshot line_bg_fetcher{};      //fetchers as the current line's mode 3 found them
+    SpriteFetcher::Snapshot line_spr_fetcher{};
+    void untime_line();     //drop a line timed ahead back to stepped fetchers
+    void render_scanline();
 
 public: //state machine
     PPU(Bus& bus, MMU& mmu, InterruptController& interrupt_controller);
@@ -59,16 +96,73 @@ public: //state machine
         screen = display;
     }
 
-    using StateFunction = void (PPU::*)();  //pointer to state function
     enum class State {
         OAM_SCAN, PIXEL_TRANSFER, H_BLANK, V_BLANK,
     };
-    StateFunction current_state;
-    State curr_state_enum;
+    State current_state = State::OAM_SCAN;
+
+    //FIFO steps the pixel fetchers dot by dot; SCANLINE keeps the mode
+    //timings but draws each line in one go when mode 3 ends, so register
+    //writes in the middle of a line are not seen on screen. they still
+    //stall mode 3 as they would the fifo
+    enum class Renderer {FIFO, SCANLINE};
+    void set_renderer(Renderer r) {renderer = r; timed_dots = 0;}
+    Renderer get_renderer() const {return renderer;}
+    //lines starting mode 3 while set are timed, scanned and interrupt
+    //as usual, but nothing is fetched from vram or drawn, so the screen
+    //keeps what was there before
+    void set_render_skip(bool skip) {render_skip = skip;}
+    bool get_render_skip() const {return render_skip;}
     //PPU is clocked in t-states (4 t-state = 1 m-cycle)
-    void tick();
+    //runs a batch of dots
+    void run(unsigned long dots);
+    //run all dots up to the current bus cycle, then plan the next event
+    void sync();
+    void reschedule();
+    //dots that can run from here before LY or STAT read differently,
+    //-1 if they never will; only meaningful right after sync()
+    long quiet_dots() const;
+    //dots that can run from here before the ppu next reads oam, -1 if it
+    //never will; only meaningful right after sync()
+    long oam_quiet_dots() const;
+    //oam dma is about to start; only meaningful right after sync()
+    void oam_dma_starting();
+    //a register in LCDC..WX is about to take val; only meaningful right
+    //after sync()
+    void timing_register_writing(uint16_t addr, uint8_t val);
 
     void print_state();
+
+    //everything but the settings and the screen, for snapshots; the
+    //registers themselves are saved with the mmu's register file, which
+    //has to be restored first
+    struct Snapshot {
+        VRAM::Snapshot vram;
+        OAM::Snapshot oam;
+        PixelFetcher::Snapshot bg_fetcher;
+        SpriteFetcher::Snapshot spr_fetcher;
+        SpriteBuffer spr_buf;
+        BgFifo bg_fifo;
+        SprFifo spr_fifo;
+        uint8_t scanline_x;
+        std::array<uint8_t, 256> line;
+        bool line_drawn, frame_drawn;
+        uint8_t oam_counter;
+        bool in_window;
+        int cycles;
+        EdgeDetector stat_trigger;
+        unsigned long synced;
+        State current_state;
+        int transfer_end;
+        PixelFetcher::Snapshot line_bg_fetcher;
+        SpriteFetcher::Snapshot line_spr_fetcher;
+        uint8_t line_scx, line_scy;
+    };
+    void save_state(Snapshot& state) const;
+    void load_state(const Snapshot& state);
+
+private:
+    Renderer renderer = Renderer::FIFO;
 };  
 
 #endif
\ No newline at end of file
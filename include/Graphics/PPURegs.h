@@ -6,19 +6,28 @@
 #include "Memory/IO.h"
 
 class MMU;
-class Bus;
 
 class PPURegs : public IO {
-private:
-    static constexpr uint16_t START = 0xFF40;
-    static constexpr uint16_t END   = 0xFF4B;
-    Bus& bus;
 public:
-    PPURegs(Bus& bus, MMU& mmu);
-    uint8_t lcdc, stat, scy, scx, ly, lyc, dma, bgp, obp_0, obp_1, wy, wx;
+    PPURegs(MMU& mmu);
+    //views into the mmu's register file; reads of all of them and most
+    //writes are plain byte accesses there
+    uint8_t &lcdc, &stat, &scy, &scx, &ly, &lyc, &dma, &bgp, &obp_0, &obp_1, &wy, &wx;
 
-    uint8_t read(uint16_t addr) override;
+    //STAT mode bits and LY are read only; palette writes refresh the
+    //shade tables
     void write(uint16_t addr, uint8_t val) override;
+
+    enum Palette : uint8_t {BG_PALETTE, OBJ_PALETTE_0, OBJ_PALETTE_1};
+    //shade (0-3) a color index shows as under a palette
+    uint8_t shade(Palette palette, uint8_t color) const {return shades[palette][color];}
+    //rebuilds the shade tables after the register file was restored
+    void reload_shades();
+
+private:
+    //BGP, OBP0 and OBP1 unpacked, rebuilt only when one is written
+    std::array<std::array<uint8_t, 4>, 3> shades;
+    void update_shades(Palette palette, uint8_t val);
 };  
 
 //LCDC bit checks
@@ -16,14 +16,15 @@ class PixelFetcher {
 //finding the tile its on, and fetching the appropriate tile row
 private:
     //data
-    std::array<uint8_t, 8> px_buf;
-    uint8_t x_pos, y_pos;           //current pos wrt tilemap origin
-    Tile tile_data;                 //current tile data
-    uint8_t tile_index;             //index of current tile 
+    std::array<uint8_t, 8> px_buf{};
+    uint8_t x_pos = 0, y_pos = 0;   //current pos wrt tilemap origin
+    uint16_t tile_number = 0;       //current tile in the tile cache
+    uint8_t tile_index = 0;         //index of current tile 
     uint8_t cycles = 0;
 
-    bool stop_pending;
+    bool stop_pending = false;
     bool on;
+    bool blank = false;     //push color 0 without reading vram
 
     //storage access
     const VRAM& vram;      
@@ -52,14 +53,49 @@ public:
     void set_position(uint8_t x, uint8_t y);
     void start();
     void request_stop();    
+    void reset();           //back to the power-on state, idle on the background
+    //blank fetches take as long as real ones, so mode 3 timing holds
+    void set_blank(bool enabled) {blank = enabled;}
 
     //getters/setters
     bool active() const {return on;}
+    bool stop_requested() const {return stop_pending;}
 
 public:
     StateFunction curr_state;
     State curr_state_enum;
-    Mode curr_mode;
+    Mode curr_mode = Mode::BG_FETCH;
+
+    //snapshots
+    struct Snapshot {
+        std::array<uint8_t, 8> px_buf;
+        uint8_t x_pos, y_pos;
+        uint16_t tile_number;
+        uint8_t tile_index;
+        uint8_t cycles;
+        bool stop_pending, on, blank;
+        StateFunction curr_state;
+        State curr_state_enum;
+        Mode curr_mode;
+    };
+    void save_state(Snapshot& state) const {
+        state = {px_buf, x_pos, y_pos, tile_number, tile_index, cycles, stop_pending, on, blank,
+                 curr_state, curr_state_enum, curr_mode};
+    }
+    void load_state(const Snapshot& state) {
+        px_buf = state.px_buf;
+        x_pos = state.x_pos;
+        y_pos = state.y_pos;
+        tile_number = state.tile_number;
+        tile_index = state.tile_index;
+        cycles = state.cycles;
+        stop_pending = state.stop_pending;
+        on = state.on;
+        blank = state.blank;
+        curr_state = state.curr_state;
+        curr_state_enum = state.curr_state_enum;
+        curr_mode = state.curr_mode;
+    }
 };  
 
 #endif
\ No newline at end of file
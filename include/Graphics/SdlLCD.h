@@ -0,0 +1,51 @@
+#ifndef SDLLCD_H
+#define SDLLCD_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <SDL2/SDL.h>
+#include "LCD.h"
+#include "TripleBuffer.h"
+
+class SdlLCD : public LCD {
+//SDL window backend
+//the console runs on another thread and hands finished frames over
+//through a triple buffer. the window, renderer and texture belong to the
+//main thread, which pumps events and presents the newest frame, so
+//waiting for vsync never stalls emulation
+private:
+    unsigned int scale;
+
+public:
+    SdlLCD(unsigned int window_scale);
+
+    void init();
+    //SDL textures have no paletted formats, so only RGB565 and ARGB8888
+    //can be shown; main thread, before the console starts running
+    void set_format(Format format) override;
+    //hands the frame to the main thread; emulation thread
+    void frame_ready() override;
+    //frames are shown by present()
+    void draw_frame() override {}
+    //shows the newest finished frame, blocking until vsync; false without
+    //a new one. main thread
+    bool present();
+    //main thread
+    void set_title(const std::string& title);
+
+private:
+    using WindowPtr   = std::unique_ptr<SDL_Window, decltype(&SDL_DestroyWindow)>;
+    using RendererPtr = std::unique_ptr<SDL_Renderer, decltype(&SDL_DestroyRenderer)>;
+    using TexturePtr  = std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)>;
+
+    WindowPtr window{nullptr, SDL_DestroyWindow};
+    RendererPtr renderer{nullptr, SDL_DestroyRenderer};
+    TexturePtr texture{nullptr, SDL_DestroyTexture};
+    void create_texture();
+
+    TripleBuffer<std::vector<uint8_t>> frames;
+    void reset_frames();
+};
+
+#endif
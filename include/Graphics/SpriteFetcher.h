@@ -8,14 +8,13 @@
 #include "Sprite.h"
 #include "Tile.h"
 #include <iostream>
-#include <format>
 
 class VRAM;
 class PPURegs;
 
 class SpriteFetcher {
 private:
-    std::array<uint8_t, 8> px_buf;
+    std::array<uint8_t, 8> px_buf{};
     RingBuffer<Sprite, 8> spr_queue;
 
     //storage access
@@ -23,18 +22,19 @@ private:
     const PPURegs& regs; 
     SprFifo& fifo;
 
-    uint8_t row;
-    uint8_t tile_index;
+    uint8_t row = 0;
+    uint8_t tile_index = 0;
     
     //FSM behavior
     bool on = false;    //the spr fifo only works periodically
+    bool blank = false; //push transparent pixels without reading vram
     int cycles = 0;
 public: 
     SpriteFetcher(const VRAM& vram, const PPURegs& control, SprFifo& sprite_fifo)
         : vram{vram},
           regs{control},
           fifo{sprite_fifo},
-          curr_state{get_tile_index}
+          curr_state{&SpriteFetcher::get_tile_index}
           {}
 
     //getter/setter
@@ -51,6 +51,8 @@ public:
     void reset_fetch();
     void tick();
     void clear_queue() { spr_queue.clear(); }
+    //blank fetches take as long as real ones, so mode 3 timing holds
+    void set_blank(bool enabled) {blank = enabled;}
 
     //state functions
     using StateFunction = void(SpriteFetcher::*)();
@@ -59,6 +61,29 @@ public:
     void get_tile_line();
     void push_to_fifo();
 
+    //snapshots; queued sprites point into the console's own oam
+    struct Snapshot {
+        std::array<uint8_t, 8> px_buf;
+        RingBuffer<Sprite, 8> spr_queue;
+        uint8_t row, tile_index;
+        bool on, blank;
+        int cycles;
+        StateFunction curr_state;
+    };
+    void save_state(Snapshot& state) const {
+        state = {px_buf, spr_queue, row, tile_index, on, blank, cycles, curr_state};
+    }
+    void load_state(const Snapshot& state) {
+        px_buf = state.px_buf;
+        spr_queue = state.spr_queue;
+        row = state.row;
+        tile_index = state.tile_index;
+        on = state.on;
+        blank = state.blank;
+        cycles = state.cycles;
+        curr_state = state.curr_state;
+    }
+
 private:
     StateFunction curr_state;
 };
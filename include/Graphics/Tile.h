@@ -4,7 +4,6 @@
 #include <cstdint>
 #include <array>
 #include <span>
-#include <format>
 #include <iostream>
 
 class MMU;
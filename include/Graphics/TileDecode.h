@@ -0,0 +1,22 @@
+#ifndef TILEDECODE_H
+#define TILEDECODE_H
+
+#include <cstdint>
+#include <cstddef>
+
+//2bpp tile rows to one color index (0-3) per byte
+//the input is tile data as it sits in VRAM: a low and a high plane byte
+//per row. each row comes out as 8 bytes, leftmost pixel first, or
+//rightmost first when x_flip is set
+namespace TileDecode {
+    //picks the widest kernel the cpu supports on first use
+    void rows(const uint8_t* planes, size_t count, uint8_t* pixels, bool x_flip = false);
+
+    //the plain loop every kernel must agree with
+    void rows_scalar(const uint8_t* planes, size_t count, uint8_t* pixels, bool x_flip = false);
+
+    //name of the kernel rows() dispatches to
+    const char* kernel_name();
+}
+
+#endif
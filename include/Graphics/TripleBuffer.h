@@ -0,0 +1,50 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+//hands the latest value from one producer thread to one consumer thread
+//without locks; neither side ever waits for the other. the producer fills
+//its slot and publishes it, the consumer picks up the newest published
+//slot, and values the consumer was too slow to see are dropped
+template <typename T>
+class TripleBuffer {
+private:
+    std::array<T, 3> slots{};
+    //slot between the two sides, FRESH if published since last taken
+    static constexpr uint8_t FRESH = 0x04;
+    static constexpr uint8_t SLOT  = 0x03;
+    std::atomic<uint8_t> middle{1};
+    uint8_t back  = 0;      //producer's slot
+    uint8_t front = 2;      //consumer's slot
+
+public:
+    //producer side
+    T& back_slot() {return slots[back];}
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & SLOT;
+    }
+
+    //consumer side
+    //moves to the newest published slot, false if nothing new came in
+    bool take() {
+        if(!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & SLOT;
+        return true;
+    }
+    const T& front_slot() const {return slots[front];}
+
+    //only while neither side is running
+    void fill(const T& value) {
+        slots.fill(value);
+        middle.store(1);
+        back = 0;
+        front = 2;
+    }
+};
+
+#endif
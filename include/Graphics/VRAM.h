@@ -3,8 +3,11 @@
 
 #include <cstdint>
 #include <array>
-#include "memory/MMU.h"
+#include <bitset>
+#include <algorithm>
+#include "Memory/MMU.h"
 #include "Tile.h"
+#include "TileDecode.h"
 
 class Tile;
 class PPU;
@@ -15,9 +18,14 @@ public:
     static constexpr uint16_t END = 0x9FFF;
     enum class AddressMode {UNSIGNED, SIGNED};
 
+    static constexpr int TILE_COUNT = 384;
+    using TileRow = std::array<uint8_t, 8>;     //color indices, leftmost first
+
     VRAM(MMU& mmu)
         {
             mmu.map_region(START, END, data.data());
+            mmu.connect_VRAM(this);
+            dirty.set();
         }
 
     uint8_t read(uint16_t addr) const { 
@@ -25,8 +33,29 @@ public:
         return data[addr - START];
     }
     void write(uint16_t addr, uint8_t val) {
-        //PPU-facing; unrestricted VRAM write
+        //unrestricted VRAM write; the mmu routes cpu writes here once it
+        //has checked the lock
         data[addr - START] = val;
+        if(addr < Space::TILEMAP_0) {
+            dirty.set((addr - START) / 0x10);
+        }
+    }
+
+    //tile number (0-383) an index from a tile map or OAM refers to
+    uint16_t tile_number(uint8_t index, AddressMode addr_mode) const {
+        switch(addr_mode) {
+            case AddressMode::SIGNED:
+                return (Space::TILEBLOCK_2 - START) / 0x10 + static_cast<int8_t>(index);
+            default:
+                return index;
+        }
+    }
+    //decoded row of a tile, decoded again only after a write to the tile
+    const TileRow& tile_row(uint16_t number, uint8_t row, bool x_flip = false) const {
+        if(dirty[number]) {
+            decode(number);
+        }
+        return (x_flip ? flipped_rows : rows)[number * 8 + row];
     }
 
     Tile tile_at(uint8_t index, AddressMode addr_mode) const {
@@ -42,23 +71,56 @@ public:
         return Tile{ &data[addr - START] };
     }
 
-    void block(MMU& mmu) {
-        if(accessible) {
-            accessible = false;
-            mmu.unmap_region(START, END);
+    //snapshots; tiles a restore changes are decoded again on next use
+    using Snapshot = std::array<uint8_t, 0x2000>;
+    void save_state(Snapshot& state) const {state = data;}
+    void load_state(const Snapshot& state) {
+        for(int number = 0; number < TILE_COUNT; ++number) {
+            auto tile = state.begin() + number * 0x10;
+            if(!std::equal(tile, tile + 0x10, data.begin() + number * 0x10)) {
+                dirty.set(number);
+            }
         }
+        data = state;
+    }
+
+    void block(MMU& mmu) {
+        mmu.lock(MMU::VRAM_LOCK);
     }
     
     void unblock(MMU& mmu) {
-        if(!accessible) {
-            mmu.map_region(START, END, data.data());
-            accessible = true;
-        }
+        mmu.unlock(MMU::VRAM_LOCK);
     }
 
 private:
-    std::array<uint8_t, 0x2000> data;
-    bool accessible = true;
+    std::array<uint8_t, 0x2000> data{};
+
+    //tile cache, both as stored and mirrored for x-flipped sprites
+    mutable std::array<TileRow, TILE_COUNT * 8> rows;
+    mutable std::array<TileRow, TILE_COUNT * 8> flipped_rows;
+    mutable std::bitset<TILE_COUNT> dirty;
+
+    void decode(uint16_t number) const {
+        //a tile's rows are contiguous in vram and in both caches, and so
+        //are neighbouring tiles, so the whole run of dirty tiles around
+        //this one goes to the decoder in one call. tile data is usually
+        //written a block at a time, which gives the wide kernels long runs
+        int first = number;
+        int last = number + 1;
+        while(first > 0 && dirty[first - 1]) {
+            first--;
+        }
+        while(last < TILE_COUNT && dirty[last]) {
+            last++;
+        }
+        const uint8_t* planes = &data[first * 0x10];
+        size_t count = (last - first) * 8;
+        TileDecode::rows(planes, count, rows[first * 8].data());
+        TileDecode::rows(planes, count, flipped_rows[first * 8].data(), true);
+        for(int n = first; n < last; ++n) {
+            dirty.reset(n);
+        }
+    }
 };
 
 #endif
\ No newline at end of file
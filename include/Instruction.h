@@ -22,6 +22,8 @@ namespace Operation {
         void and_8(CPU& cpu, uint8_t num);
         void or_8(CPU& cpu, uint8_t num);
         void xor_8(CPU& cpu, uint8_t num);
+        //sp plus a signed offset; sets flags and returns the sum
+        uint16_t add_sp_e(CPU& cpu, uint8_t offset);
     }
 
 //------------------------ LOADS ------------------------//
@@ -49,6 +51,7 @@ void LD_SP_HL(CPU& cpu);
 void LD_SP_n16(CPU& cpu);
 void PUSH_rr(CPU& cpu, uint8_t& hi, uint8_t& lo);
 void POP_rr(CPU& cpu, uint8_t& hi, uint8_t& lo);
+void PUSH_AF(CPU& cpu);
 void POP_AF(CPU& cpu);
 void LD_HL_SPe(CPU& cpu);
 
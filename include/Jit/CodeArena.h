@@ -0,0 +1,48 @@
+#ifndef CODEARENA_H
+#define CODEARENA_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct Block;
+
+//fixed-size executable memory split into equal slots, one per translated block
+//when every slot is taken the least recently run block loses its translation
+//the memory is never writable and executable at once: a slot is opened for
+//writing while a block is translated into it and sealed before it runs
+class CodeArena {
+public:
+    static constexpr size_t SLOT_SIZE  = 8 * 1024;
+    static constexpr size_t SLOT_COUNT = 1024;
+private:
+    struct Slot {
+        Block* owner = nullptr;
+        unsigned long last_used = 0;
+    };
+    uint8_t* base = nullptr;
+    bool refused = false;   //a protection change failed
+    bool protect(int slot, int prot);
+    std::vector<Slot> slots;
+    size_t used = 0;
+    unsigned long clock = 0;
+public:
+    CodeArena();
+    ~CodeArena();
+    CodeArena(const CodeArena&) = delete;
+    CodeArena& operator=(const CodeArena&) = delete;
+
+    //false if the platform refused the mapping or making it executable
+    bool available() const {return base != nullptr && !refused;}
+
+    //a slot for owner; reuses the owner's previous slot if it still holds it
+    int allocate(Block& owner);
+    uint8_t* code(int slot) {return base + slot * SLOT_SIZE;}
+    void touch(int slot) {slots[slot].last_used = ++clock;}
+    //read/write for translating into, then read/execute again; false if the
+    //platform refused, which leaves the arena unavailable
+    bool open(int slot);
+    bool seal(int slot);
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstdint>
+#include "Jit/CodeArena.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define GB5_JIT_X64 1
+#endif
+
+class CPU;
+class Bus;
+class MMU;
+class InterruptController;
+struct Block;
+
+//translates hot rom blocks into x86-64
+//register moves, 8-bit alu ops, inc/dec and relative/absolute jumps become
+//native code with the cycle counter bumped inline. loads, stores, stack ops,
+//calls and returns read and write host memory through the mmu's page
+//tables; a guard on each access falls back to the op's decoded handler,
+//and so the bus, for the io page, vram, oam, mbc registers, pages holding
+//decoded code and 16-bit accesses across a page. generated code polls the
+//scheduler after every op and returns at the same boundaries as
+//CPU::run_block
+class Jit {
+public:
+    //executions of a block before it is worth translating
+    static constexpr unsigned HOT_THRESHOLD = 16;
+
+    static bool supported();
+private:
+    CPU& cpu;
+    Bus& bus;
+    MMU& mmu;
+    InterruptController& interrupt_controller;
+    CodeArena arena;
+
+    unsigned long until = 0;        //read by generated code on entry
+    const Block* running = nullptr;
+
+    bool compile(Block& block, uint16_t pc);
+public:
+    //called from generated code
+    //poll runs due events and says whether the block has to stop
+    static bool poll(Jit* jit);
+    static void run_events(Jit* jit);
+
+    Jit(CPU& cpu, Bus& bus, MMU& mmu, InterruptController& ic);
+
+    //run block natively if it is (or just became) translated
+    //false leaves the block to the cached engine
+    bool run(Block& block, uint16_t pc, unsigned long until);
+};
+
+#endif
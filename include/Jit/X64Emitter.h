@@ -0,0 +1,94 @@
+#ifndef X64EMITTER_H
+#define X64EMITTER_H
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+//minimal x86-64 machine code writer for the jit
+//only the handful of encodings the translator needs; registers are fixed:
+//rbx = cpu, r12 = bus cycle counter, r13 = until, r14 = next event, r15 = jit
+class X64Emitter {
+public:
+    //condition nibbles for jcc
+    //group 1 alu selectors, the /digit of the encoding
+    enum Alu : uint8_t {
+        ADD = 0, OR = 1, ADC = 2, SBB = 3, AND = 4, SUB = 5, XOR = 6, CMP = 7
+    };
+    enum Cond : uint8_t {
+        BELOW = 0x2, ABOVE_EQUAL = 0x3, EQUAL = 0x4, NOT_EQUAL = 0x5
+    };
+private:
+    uint8_t* start;
+    uint8_t* p;
+    uint8_t* limit;
+
+    template<typename T>
+    void put(T value) {
+        std::memcpy(p, &value, sizeof(T));
+        p += sizeof(T);
+    }
+public:
+    X64Emitter(uint8_t* code, size_t size) : start{code}, p{code}, limit{code + size} {}
+
+    uint8_t* here() const {return p;}
+    size_t room() const {return limit - p;}
+
+    void bytes(std::initializer_list<uint8_t> b) {
+        for(uint8_t x : b) put(x);
+    }
+    void imm8(uint8_t v)   {put(v);}
+    void imm16(uint16_t v) {put(v);}
+    void imm32(int32_t v)  {put(v);}
+    void imm64(uint64_t v) {put(v);}
+
+    //[rbx + disp32] forms, disp is an offset into the cpu object
+    void load_byte(int32_t disp)  {bytes({0x0F, 0xB6, 0x83}); imm32(disp);}    //movzx eax, byte
+    void store_byte(int32_t disp) {bytes({0x88, 0x83}); imm32(disp);}          //mov byte, al
+    void store_byte_imm(int32_t disp, uint8_t v) {bytes({0xC6, 0x83}); imm32(disp); imm8(v);}
+    void store_word_imm(int32_t disp, uint16_t v) {bytes({0x66, 0xC7, 0x83}); imm32(disp); imm16(v);}
+    void load_byte_ecx(int32_t disp) {bytes({0x0F, 0xB6, 0x8B}); imm32(disp);} //movzx ecx, byte
+    void store_byte_ah(int32_t disp) {bytes({0x88, 0xA3}); imm32(disp);}       //mov byte, ah
+    void or_byte_cl(int32_t disp) {bytes({0x08, 0x8B}); imm32(disp);}          //or byte, cl
+    void not_byte(int32_t disp) {bytes({0xF6, 0x93}); imm32(disp);}
+    void test_byte_imm(int32_t disp, uint8_t v) {bytes({0xF6, 0x83}); imm32(disp); imm8(v);}
+    //<alu> byte [rbx + disp], imm8
+    void byte_imm(uint8_t ext, int32_t disp, uint8_t v) {
+        bytes({0x80, static_cast<uint8_t>(0x83 | ext << 3)}); imm32(disp); imm8(v);
+    }
+    void cmp_word_imm(int32_t disp, uint16_t v) {bytes({0x66, 0x81, 0xBB}); imm32(disp); imm16(v);}
+    void load_word(int32_t disp)  {bytes({0x0F, 0xB7, 0x83}); imm32(disp);}    //movzx eax, word
+    void store_word(int32_t disp) {bytes({0x66, 0x89, 0x83}); imm32(disp);}    //mov word, ax
+    //<alu> word [rbx + disp], imm8 sign extended
+    void word_imm(uint8_t ext, int32_t disp, int8_t v) {
+        bytes({0x66, 0x83, static_cast<uint8_t>(0x83 | ext << 3)}); imm32(disp); imm8(v);
+    }
+    void inc_byte(int32_t disp) {bytes({0xFE, 0x83}); imm32(disp);}
+    void dec_byte(int32_t disp) {bytes({0xFE, 0x8B}); imm32(disp);}
+    void inc_word(int32_t disp) {bytes({0x66, 0xFF, 0x83}); imm32(disp);}
+    void dec_word(int32_t disp) {bytes({0x66, 0xFF, 0x8B}); imm32(disp);}
+    //<alu> al, byte [rbx + disp]; ext selects add/or/adc/sbb/and/sub/xor/cmp
+    void alu_byte(uint8_t ext, int32_t disp) {bytes({static_cast<uint8_t>(0x02 + ext * 8), 0x83}); imm32(disp);}
+    //<alu> al, imm8
+    void alu_imm(uint8_t ext, uint8_t v) {bytes({static_cast<uint8_t>(0x04 + ext * 8)}); imm8(v);}
+
+    void add_cycles(uint8_t n) {bytes({0x49, 0x83, 0x04, 0x24}); imm8(n);}     //add qword [r12], n
+    void mov_rax_imm(uint64_t v) {bytes({0x48, 0xB8}); imm64(v);}
+    void mov_rsi_imm(uint64_t v) {bytes({0x48, 0xBE}); imm64(v);}
+    void mov_rdx_imm(uint64_t v) {bytes({0x48, 0xBA}); imm64(v);}
+    void mov_eax_imm(uint32_t v) {bytes({0xB8}); imm32(v);}
+
+    //rel32 jumps; the returned pointer is patched with bind()
+    uint8_t* jmp() {bytes({0xE9}); imm32(0); return p;}
+    uint8_t* jcc(Cond c) {bytes({0x0F, static_cast<uint8_t>(0x80 | c)}); imm32(0); return p;}
+    void jcc_to(Cond c, const uint8_t* target) {bind(jcc(c), target);}
+    void jmp_to(const uint8_t* target) {bind(jmp(), target);}
+    //point the jump ending at from to target
+    static void bind(uint8_t* from, const uint8_t* target) {
+        int32_t rel = static_cast<int32_t>(target - from);
+        std::memcpy(from - 4, &rel, 4);
+    }
+    void bind(uint8_t* from) {bind(from, p);}
+};
+
+#endif
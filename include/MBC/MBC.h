@@ -14,6 +14,11 @@ protected:
 public:
     virtual ~MBC()=default;
     virtual void write(uint16_t addr, uint8_t val) = 0;
+
+    //bank registers, for snapshots; each mbc packs its own
+    using Snapshot = std::array<uint8_t, 4>;
+    virtual void save_state(Snapshot& state) const {}
+    virtual void load_state(const Snapshot& state) {}
 };
 
 #endif
\ No newline at end of file
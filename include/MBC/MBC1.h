@@ -5,9 +5,9 @@
 
 class MBC1 : public MBC {
 private:
-    uint8_t rom_select_lo : 5;  
-    uint8_t rom_select_hi : 2; 
-    enum class SelectMode {RAM, ROM_UPPER} select_mode;
+    uint8_t rom_select_lo : 5 = 1;  
+    uint8_t rom_select_hi : 2 = 0; 
+    enum class SelectMode {RAM, ROM_UPPER} select_mode = SelectMode::RAM;
 public:
     MBC1(Cart& cartridge) 
         :MBC{cartridge} 
@@ -15,6 +15,8 @@ public:
         }
 
     void write(uint16_t addr, uint8_t val) override;
+    void save_state(Snapshot& state) const override;
+    void load_state(const Snapshot& state) override;
 };
 
 
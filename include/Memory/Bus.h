@@ -2,7 +2,9 @@
 #define BUS_H
 
 #include <cstdint>
+#include <algorithm>
 #include "DmaController.h"
+#include "Scheduler.h"
 
 class MMU;
 class CPU;
@@ -20,8 +22,13 @@ private:
     Timer* tim;
 
     DmaController dmac;
+    Scheduler scheduler;
 
     unsigned long cycles = 0;
+
+    void run_events();
+    void dma_step();
+    void catch_up(uint16_t addr);
 public:
     void connect(MMU& Mmu)   {mmu = &Mmu;}
     void connect(CPU& Cpu)   {cpu = &Cpu;} 
@@ -29,11 +36,68 @@ public:
     void connect(JoyPad& Jp) {jp  = &Jp;}  
     void connect(Timer& Tim) {tim = &Tim;}  
 
-    void cycle();
+    //advance one m-cycle; the ppu and timer only run when an event is due
+    //or their state is observed
+    void cycle() {
+        if(dmac.active()) {
+            dma_step();
+        }
+        cycles++;
+        if(cycles >= scheduler.next()) {
+            run_events();
+        }
+    }
     uint8_t read(uint16_t addr);
     void write(uint16_t addr, uint8_t val);
 
     unsigned long get_cycles() const {return cycles;}
+    unsigned long next_event() const {return scheduler.next();}
+
+    //generated code advances the counter itself while the bus is idle and
+    //calls run_due_events() once it passes the next event
+    unsigned long* cycle_counter() {return &cycles;}
+    const unsigned long* next_event_address() const {return scheduler.next_address();}
+    void run_due_events() {
+        if(cycles >= scheduler.next()) {
+            run_events();
+        }
+    }
+
+    //skip idle m-cycles up to the next event or limit, whichever is first,
+    //and run whatever became due; the ppu and timer catch up over the whole
+    //range when they sync. only for stretches where nothing is clocked per
+    //cycle, i.e. no dma
+    void fast_forward(unsigned long limit) {
+        unsigned long target = std::min(limit, scheduler.next());
+        if(target > cycles) {
+            cycles = target;
+        }
+        run_due_events();
+    }
+
+    //first m-cycle at which a read of addr might return something other
+    //than it does now, assuming only scheduled events and the lazily
+    //clocked ppu change memory; cycles if that cannot be ruled out
+    unsigned long stable_until(uint16_t addr);
+
+    //event scheduling on the m-cycle timeline
+    void schedule(Event ev, unsigned long when) {scheduler.schedule(ev, when);}
+    void cancel(Event ev) {scheduler.cancel(ev);}
+    //bring lazily clocked components up to the current cycle
+    void sync();
+
+    //timeline and dma, for snapshots
+    struct Snapshot {
+        unsigned long cycles;
+        DmaController dmac;
+        Scheduler scheduler;
+    };
+    void save_state(Snapshot& state) const {state = {cycles, dmac, scheduler};}
+    void load_state(const Snapshot& state) {
+        cycles = state.cycles;
+        dmac = state.dmac;
+        scheduler = state.scheduler;
+    }
 
     //dma functions
     OAM* oam_dma_dest;
@@ -45,4 +109,4 @@ inline bool addr_in_hram(uint16_t addr) {
     return (0xFF80 <= addr) && (addr <= 0xFFFE);
 }
 
-#endif
\ No newline at end of file
+#endif
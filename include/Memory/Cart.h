@@ -38,6 +38,7 @@ public:
         size_t max_bank = num_rom_banks - 1;    
         rom_bank2 = rom_bank1 + (bank_number & max_bank) * 0x4000;
 		mmu.map_region(Space::ROM_BANK2_START, Space::ROM_BANK2_END, rom_bank2);
+		mmu.set_rom_bank(bank_number & max_bank);
     }
     void swap_ram_bank(uint8_t bank_number) {
         size_t max_bank = num_ram_banks - 1;
@@ -46,6 +47,18 @@ public:
 
     void enable_ext_ram();
     void disable_ext_ram();
+
+    //banking and external ram contents, for snapshots; the mmu saves
+    //which pages are mapped
+    struct Snapshot {
+        bool ram_enable;
+        uint8_t* rom_bank2;
+        uint8_t* ram_bank;
+        std::vector<uint8_t> ram;
+        MBC::Snapshot mbc;
+    };
+    void save_state(Snapshot& state) const;
+    void load_state(const Snapshot& state);
 };
 
 enum class CartType : uint8_t {
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <iostream>
+#include <array>
 
 constexpr unsigned int DMA_CYCLES = 160;
 
@@ -11,12 +12,21 @@ private:
     uint16_t cycles = 0; 
     bool on = false;
     uint16_t start_addr;
+    //the whole block was copied at start; the window only blocks the bus
+    bool copied = false;
 public:
+    //oam bytes a bulk copy overwrote ahead of schedule, to undo the part
+    //that had not landed yet if the transfer is restarted
+    std::array<uint8_t, DMA_CYCLES> displaced;
 
-    void start(uint16_t addr) {
+    void start(uint16_t addr, bool bulk = false) {
         cycles = 0;
         start_addr = addr;
         on = true;
+        copied = bulk;
+    }
+    bool bulk() const {
+        return copied;
     }
     void tick() {
         if(on) {
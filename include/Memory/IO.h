@@ -4,21 +4,21 @@
 #include <cstdint>
 
 struct IO {
-//abstract IO register
+//device behind io registers whose accesses have side effects; the mmu
+//only calls it for the registers it hooked, the rest are plain bytes
 public:
-    virtual uint8_t read(uint16_t addr) = 0;
-    virtual void write(uint16_t addr, uint8_t val) = 0;
+    virtual uint8_t read(uint16_t addr) {return 0xFF;}
+    virtual void write(uint16_t addr, uint8_t val) {}
 };
 
-struct MappedRegister : IO {
+struct MappedRegister {
+//register with no side effects, kept in the mmu's register file
 private:
-    uint8_t data;
+    uint8_t* data;
 public:
-    uint8_t get() const {return data;}
-    void set(uint8_t val) {data = val;}
-
-    uint8_t read(uint16_t addr) override {return get();}
-    void write(uint16_t addr, uint8_t val) override {set(val);}
+    MappedRegister(uint8_t& reg) :data{&reg} {}
+    uint8_t get() const {return *data;}
+    void set(uint8_t val) {*data = val;}
 };
 
 #endif
\ No newline at end of file
@@ -30,7 +30,9 @@ public:
     
 public:
     InterruptController(MMU& mem);
-    bool active();
+    bool active() const {
+        return (irq.get() & ie.get() & 0x1F);
+    }
     void request(Interrupt kind);
     void clear(Interrupt kind);
 
@@ -4,33 +4,106 @@
 #include <cstdint>
 #include <memory>
 #include <array>
+#include <bitset>
 #include "IO.h"
 #include "Spaces.h"
+#include "Profiler.h"
 
 class Bus;
 class MBC;
+class VRAM;
 
 class MMU {
-private:   
-    std::array<uint8_t*, 0x100> pages;
-    std::array<IO*, 0x100> io_registers;
-    std::array<uint8_t, 127> hram;
+public:
+    //what serves a page that has no direct host memory in the table
+    enum class Handler : uint8_t {
+        UNMAPPED,   //open bus: reads 0xFF, writes ignored
+        MBC,        //rom writes are mbc commands
+        VRAM,       //vram, unless the ppu has it locked
+        OAM,        //oam, unless locked; writes skip the unusable tail
+        HIGH,       //io registers and hram
+    };
+    //regions the ppu can lock away from the cpu
+    enum Lock : uint8_t {
+        VRAM_LOCK = 0x01,
+        OAM_LOCK  = 0x02,
+    };
+private:
+    std::array<uint8_t*, 0x100> pages;          //memory mapped at each page
+    //per page host memory to access directly, nullptr where the handler
+    //has to run instead
+    std::array<uint8_t*, 0x100> read_pages;
+    std::array<uint8_t*, 0x100> write_pages;
+    std::array<Handler, 0x100> read_handlers;
+    std::array<Handler, 0x100> write_handlers;
+
+    //ff00-ffff: io registers, hram and IE as plain bytes. registers with
+    //side effects set a hook bit and are served by their device instead
+    std::array<uint8_t, 0x100> high{};
+    std::bitset<0x100> read_hooks;
+    std::bitset<0x100> write_hooks;
+    std::array<IO*, 0x100> io_hooks;
+
+    uint8_t locks = 0;  //Lock bits currently held by the ppu
 
-    std::array<uint8_t, 0x10000> fallback;
+    MBC* mbc = nullptr;
+    VRAM* vram = nullptr;   //takes vram writes so it can track its tile cache
+    uint16_t current_rom_bank = 1;  //bank mapped at 4000-7FFF
 
-    MBC* mbc;
+    void update_page(uint8_t page);
+    uint8_t read_slow(uint16_t addr);
+    void write_slow(uint16_t addr, uint8_t val);
 public:
     MMU(Bus& bus);
     ~MMU();
     void map_region(uint16_t start, uint16_t end, uint8_t* data);
     void unmap_region(uint16_t start, uint16_t end);
-    void map_io_region(uint16_t start, uint16_t end, IO* io_reg);
-    void map_io_register(uint16_t addr, IO* io_reg);
+    //host memory behind addr's page if reads of it are plain loads
+    const uint8_t* direct_page(uint16_t addr) const {return read_pages[addr >> 8];}
+    //the same per page pointers for generated code, indexed by addr >> 8;
+    //bank switches update them in place
+    uint8_t* const* read_page_table() const {return read_pages.data();}
+    uint8_t* const* write_page_table() const {return write_pages.data();}
+    uint8_t& io_register(uint16_t addr) {return high[addr & 0xFF];}
+    void hook_io_read(uint16_t addr, IO* device);
+    void hook_io_write(uint16_t addr, IO* device);
+
+    //locking only flips a bit; vram and oam pages always go through
+    //their handlers, which check it
+    void lock(Lock region) {locks |= region;}
+    void unlock(Lock region) {locks &= ~region;}
+
+    //what the cpu sees where, the register file and hram, for snapshots
+    //host pointers only make sense to the console that saved them
+    struct Snapshot {
+        std::array<uint8_t*, 0x100> pages;
+        std::array<uint8_t, 0x100> high;
+        uint8_t locks;
+        uint16_t rom_bank;
+    };
+    void save_state(Snapshot& state) const;
+    void load_state(const Snapshot& state);
 
     void connect_MBC(MBC* Mbc) {mbc = Mbc;}
+    void connect_VRAM(VRAM* Vram) {vram = Vram;}
+    void set_rom_bank(uint16_t bank) {current_rom_bank = bank;}
+    uint16_t rom_bank() const {return current_rom_bank;}
 
-    uint8_t read(uint16_t addr);
-    void write(uint16_t addr, uint8_t val);
+    uint8_t read(uint16_t addr) {
+        PROFILE_ZONE(MMU);
+        if(uint8_t* page = read_pages[addr >> 8]) {
+            return page[addr & 0xFF];
+        }
+        return read_slow(addr);
+    }
+    void write(uint16_t addr, uint8_t val) {
+        PROFILE_ZONE(MMU);
+        if(uint8_t* page = write_pages[addr >> 8]) {
+            page[addr & 0xFF] = val;
+            return;
+        }
+        write_slow(addr, val);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstdint>
+#include <array>
+#include <climits>
+
+//events that components can register on the bus timeline
+enum class Event : uint8_t {
+    PPU, TIMER, COUNT
+};
+
+//min-heap of pending events keyed on the bus m-cycle counter
+//each event kind is pending at most once; scheduling it again moves it
+class Scheduler {
+public:
+    static constexpr unsigned long NEVER = ULONG_MAX;
+private:
+    static constexpr int EVENT_COUNT = static_cast<int>(Event::COUNT);
+
+    struct Entry {
+        unsigned long when;
+        Event event;
+    };
+    std::array<Entry, EVENT_COUNT> heap{};
+    std::array<int, EVENT_COUNT> position;  //index into heap, -1 when not pending
+    int size = 0;
+    unsigned long next_when = NEVER;        //cached top of heap
+
+    static int slot(Event ev) {return static_cast<int>(ev);}
+
+    void place(int i, Entry e) {
+        heap[i] = e;
+        position[slot(e.event)] = i;
+    }
+    void sift_up(int i) {
+        Entry e = heap[i];
+        while(i > 0) {
+            int parent = (i - 1) / 2;
+            if(heap[parent].when <= e.when) break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, e);
+    }
+    void sift_down(int i) {
+        Entry e = heap[i];
+        while(true) {
+            int child = 2*i + 1;
+            if(child >= size) break;
+            if(child + 1 < size && heap[child + 1].when < heap[child].when) {
+                child++;
+            }
+            if(e.when <= heap[child].when) break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, e);
+    }
+    void remove_at(int i) {
+        position[slot(heap[i].event)] = -1;
+        size--;
+        if(i != size) {
+            //move the last entry into the hole and restore heap order
+            Entry last = heap[size];
+            place(i, last);
+            sift_down(i);
+            sift_up(position[slot(last.event)]);
+        }
+        next_when = size ? heap[0].when : NEVER;
+    }
+public:
+    Scheduler() {
+        position.fill(-1);
+    }
+
+    //(re)schedule an event at an absolute m-cycle
+    void schedule(Event ev, unsigned long when) {
+        int i = position[slot(ev)];
+        if(i < 0) {
+            i = size++;
+            place(i, {when, ev});
+            sift_up(i);
+        } else {
+            unsigned long old = heap[i].when;
+            heap[i].when = when;
+            if(when < old) sift_up(i);
+            else sift_down(i);
+        }
+        next_when = heap[0].when;
+    }
+
+    void cancel(Event ev) {
+        int i = position[slot(ev)];
+        if(i >= 0) {
+            remove_at(i);
+        }
+    }
+
+    unsigned long when(Event ev) const {
+        int i = position[slot(ev)];
+        return (i < 0) ? NEVER : heap[i].when;
+    }
+
+    //earliest pending timestamp
+    unsigned long next() const {return next_when;}
+    //where next() lives, for generated code that polls it
+    const unsigned long* next_address() const {return &next_when;}
+
+    //remove and return the earliest event; only valid if next() != NEVER
+    Event pop() {
+        Event ev = heap[0].event;
+        remove_at(0);
+        return ev;
+    }
+};
+
+#endif
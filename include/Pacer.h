@@ -0,0 +1,137 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <chrono>
+#include <array>
+#include <algorithm>
+
+class Pacer {
+//keeps a frontend loop at the game boy's frame rate, or a multiple of it,
+//and decides which frames are worth drawing
+//call draw_next() before running a frame and frame_done() after it
+public:
+    using Clock = std::chrono::steady_clock;
+
+    //4194304 Hz / 70224 dots per frame
+    static constexpr double GB_FPS = 59.7275005696;
+
+    //what the last second looked like
+    struct Report {
+        double fps = 0;     //frames emulated per second
+        double speed = 0;   //fps relative to the game boy
+        double load = 0;    //share of wall time spent emulating; 1 / load is the headroom
+        double shown = 0;   //frames drawn per second
+        int skip = 0;       //frames auto skip leaves undrawn after each drawn one
+    };
+
+    //how long frames took to run, in 250 us buckets up to 40 ms
+    class Histogram {
+    public:
+        static constexpr auto BUCKET = std::chrono::microseconds(250);
+        static constexpr int BUCKETS = 160;     //the last one also counts longer frames
+
+        void add(Clock::duration time) {
+            counts[std::min<long>(time / BUCKET, BUCKETS - 1)]++;
+            total++;
+        }
+        void clear() {
+            counts.fill(0);
+            total = 0;
+        }
+        unsigned long count() const {return total;}
+        unsigned long bucket(int n) const {return counts[n];}
+        //upper edge of the bucket holding the given share of frames
+        Clock::duration percentile(double share) const {
+            if(total == 0) {
+                return Clock::duration{0};
+            }
+            unsigned long wanted = share * total;
+            unsigned long seen = 0;
+            for(int n = 0; n < BUCKETS; n++) {
+                seen += counts[n];
+                if(seen > wanted || seen == total) {
+                    return BUCKET * (n + 1);
+                }
+            }
+            return BUCKET * BUCKETS;
+        }
+
+    private:
+        std::array<unsigned long, BUCKETS> counts{};
+        unsigned long total = 0;
+    };
+
+    Pacer();
+
+    //multiple of GB_FPS to run at; 0 runs uncapped
+    void set_speed(double multiplier);
+    double get_speed() const {return speed;}
+    //runs uncapped while set, whatever the speed
+    void set_turbo(bool on) {turbo = on;}
+    bool get_turbo() const {return turbo;}
+    //the most frames per second worth drawing, usually the display refresh
+    //rate; frames beyond it are run with rendering skipped
+    void set_display_rate(double hz);
+    //while set, frames are run with rendering skipped whenever deadlines
+    //are missed, up to max_skip undrawn frames after each drawn one.
+    //the skip goes back down once drawing more often would fit again
+    void set_auto_skip(bool on);
+    bool get_auto_skip() const {return auto_skip;}
+    void set_max_skip(int frames) {max_skip = std::max(frames, 0); skip = std::min(skip, max_skip);}
+    int get_max_skip() const {return max_skip;}
+    int get_skip() const {return skip;}
+
+    bool draw_next();
+    void frame_done();
+
+    //updated once a second
+    const Report& report() const {return last_report;}
+    //running times of drawn and render-skipped frames since the last clear,
+    //for tuning the auto skip
+    const Histogram& drawn_times() const {return drawn_hist;}
+    const Histogram& skipped_times() const {return skipped_hist;}
+    void clear_histograms();
+
+private:
+    double speed = 1.0;
+    bool turbo = false;
+    Clock::duration display_period;
+
+    Clock::time_point deadline;     //when the next frame is due
+    Clock::time_point frame_start;
+    Clock::time_point next_draw;    //earliest a frame is worth drawing again
+    bool drawing = true;            //what draw_next() last answered
+
+    //sleeping is coarse; the last stretch before a deadline is spun
+    static constexpr auto SPIN = std::chrono::microseconds(1500);
+    //deadlines missed by this much are given up rather than caught up with
+    static constexpr auto MAX_LAG = std::chrono::milliseconds(100);
+    void wait_until(Clock::time_point t) const;
+
+    //auto skip
+    bool auto_skip = false;
+    int max_skip = 4;
+    int skip = 0;                   //undrawn frames wanted after each drawn one
+    int undrawn = 0;                //frames run undrawn since the last drawn one
+    int settled = 0;                //frames since skip last went up
+    int calm = 0;                   //frames in a row a lower skip would have fit
+    double drawn_cost = 0;          //running averages, in seconds
+    double skipped_cost = 0;
+    //a raise gets this many skip cycles to take effect before the next one
+    static constexpr int RAISE_CYCLES = 2;
+    //a lower skip has to fit this share of the frame period for this long
+    static constexpr double RECOVER_LOAD = 0.85;
+    static constexpr int RECOVER_FRAMES = 60;
+    void adapt(Clock::duration late, Clock::duration frame_period);
+    Histogram drawn_hist;
+    Histogram skipped_hist;
+
+    //current report window
+    Clock::time_point window_start;
+    Clock::duration busy{0};
+    unsigned long frames = 0;
+    unsigned long drawn = 0;
+    Report last_report;
+};
+
+#endif
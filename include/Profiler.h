@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <array>
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <sys/time.h>
+#define GB5_PROFILER_SAMPLING 1
+#endif
+
+//sampling profiler for the bench tool
+//a zone only records which subsystem the emulator is currently in; a
+//SIGPROF timer samples that marker, so the split is exclusive time and the
+//zones are cheap enough to leave timing mostly undisturbed.
+//zones are only compiled in when GB5_PROFILE is defined
+namespace Profiler {
+    enum class Zone : uint8_t {
+        OTHER, CPU, PPU, TIMER, DMA, MMU, COUNT
+    };
+    constexpr int ZONE_COUNT = static_cast<int>(Zone::COUNT);
+
+    inline volatile Zone current = Zone::OTHER;
+    inline volatile unsigned long samples[ZONE_COUNT] = {};
+
+    class Scope {
+    private:
+        Zone previous;
+    public:
+        explicit Scope(Zone zone) : previous{current} {
+            current = zone;
+        }
+        ~Scope() {
+            current = previous;
+        }
+    };
+
+    inline const char* zone_name(Zone zone) {
+        switch(zone) {
+            case Zone::OTHER: return "other";
+            case Zone::CPU  : return "cpu";
+            case Zone::PPU  : return "ppu";
+            case Zone::TIMER: return "timer";
+            case Zone::DMA  : return "dma";
+            case Zone::MMU  : return "mmu";
+            default: return "?";
+        }
+    }
+
+#ifdef GB5_PROFILER_SAMPLING
+    inline void on_sample(int) {
+        //the handler is the only writer, so a plain read and write will do
+        //where ++ on a volatile is deprecated
+        int zone = static_cast<int>(current);
+        samples[zone] = samples[zone] + 1;
+    }
+
+    //start sampling every interval_us microseconds of cpu time
+    inline bool start(long interval_us = 1000) {
+        for(auto& s : samples) s = 0;
+        current = Zone::OTHER;
+        std::signal(SIGPROF, on_sample);
+        itimerval timer{{0, interval_us}, {0, interval_us}};
+        return setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+    }
+    inline void stop() {
+        itimerval timer{};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        std::signal(SIGPROF, SIG_DFL);
+    }
+#else
+    inline bool start(long = 0) {return false;}
+    inline void stop() {}
+#endif
+}
+
+#ifdef GB5_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(zone) Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__){Profiler::Zone::zone}
+#else
+#define PROFILE_ZONE(zone) ((void)0)
+#endif
+
+#endif
@@ -2,7 +2,6 @@
 #define TIMER_H
 
 #include <cstdint>
-#include "EdgeDetector.h"
 #include "Memory/IO.h"
 
 class MMU;
@@ -11,30 +10,55 @@ class Bus;
 
 class Timer : public IO {
 private:
-    uint16_t div;
-    uint8_t counter;
-    uint8_t modulo;
-    uint8_t control;
-
-    unsigned long cycles;
-    EdgeDetector increment_trigger;
+    //the internal 16-bit divider is not stored; it is the number of
+    //t-cycles since div_origin, so DIV costs nothing between accesses
+    unsigned long div_origin;
+    //tima, tma and tac live in the mmu's register file
+    uint8_t& counter;
+    uint8_t& modulo;
+    uint8_t& control;
 
     InterruptController& ic;
 
+    //lazy clocking: tima is only brought up to date when observed
+    Bus& bus;
+    unsigned long synced = 0;   //bus m-cycle tima has caught up to
+
+    unsigned long now() const;
+    uint16_t divider(unsigned long t_cycle) const {
+        return static_cast<uint16_t>(t_cycle - div_origin);
+    }
+    //tima ticks on falling edges of (enable && selected divider bit)
+    bool increment_signal(uint8_t control_reg, uint16_t div) const;
+    void increment(unsigned long times);
+
 public:
     static constexpr uint16_t START = 0xFF04;
     static constexpr uint16_t END   = 0xFF07;
 
     Timer(Bus& bus, MMU& mmu, InterruptController& int_controller);
-    void tick();
+    //bring tima up to the current bus cycle, then plan the next overflow
+    void sync();
+    void reschedule();
 
+    //only DIV reads and DIV/TAC writes are hooked
     uint8_t read(uint16_t addr) override;
     void write(uint16_t addr, uint8_t val) override;
 
-    unsigned long frequency() const;
     bool enabled() const {
         return control & 0x04;
     }
+
+    //tima, tma and tac are saved with the register file
+    struct Snapshot {
+        unsigned long div_origin;
+        unsigned long synced;
+    };
+    void save_state(Snapshot& state) const {state = {div_origin, synced};}
+    void load_state(const Snapshot& state) {
+        div_origin = state.div_origin;
+        synced = state.synced;
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,498 @@
+#include <algorithm>
+#include "BlockCache.h"
+#include "Arithmetic.h"
+#include "CPU.h"
+#include "Memory/MMU.h"
+#include "Memory/Spaces.h"
+
+using Arithmetic::pair;
+using Handler = DecodedOp::Handler;
+
+namespace {
+using namespace Operation;
+
+//adapters binding decoded operands to the reference operations
+template<void(*F)(CPU&)>
+void plain(CPU& cpu, const DecodedOp& op) {F(cpu);}
+template<void(*F)(CPU&, uint8_t&)>
+void reg(CPU& cpu, const DecodedOp& op) {F(cpu, *op.r1);}
+template<void(*F)(CPU&, uint8_t&, uint8_t&)>
+void reg_pair(CPU& cpu, const DecodedOp& op) {F(cpu, *op.r1, *op.r2);}
+template<void(*F)(CPU&, uint8_t&, uint8_t&, uint8_t&)>
+void reg_triple(CPU& cpu, const DecodedOp& op) {F(cpu, *op.r1, *op.r2, *op.r3);}
+
+void ld_r_r(CPU& cpu, const DecodedOp& op) {LD_r_r(cpu, *op.r1, *op.r2);}
+void alu_r(CPU& cpu, const DecodedOp& op) {ALU_Inst_r(cpu, op.math, *op.r1);}
+void alu_m(CPU& cpu, const DecodedOp& op) {ALU_Inst_m(cpu, op.math);}
+void rot_a(CPU& cpu, const DecodedOp& op) {ROT_Inst_A(cpu, op.rot);}
+void ret_if(CPU& cpu, const DecodedOp& op) {RET_IF(cpu, op.cc);}
+void rst(CPU& cpu, const DecodedOp& op) {RST(cpu, op.arg);}
+
+//immediate operands: the fetch cycles still run, the bytes come from the decode
+void ld_r_n(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    *op.r1 = op.imm;
+}
+void ld_m_n(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.write_memory(pair(cpu.H, cpu.L), op.imm);
+}
+void ld_rr_n16(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    *op.r1 = op.imm >> 8;
+    *op.r2 = op.imm & 0xFF;
+}
+void ld_sp_n16(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    cpu.sp = op.imm;
+}
+void ld_a16_sp(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    cpu.write_memory(op.imm, cpu.sp & 0xFF);
+    cpu.write_memory(op.imm + 1, cpu.sp >> 8);
+}
+void ld_a_a16(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    cpu.A = cpu.read_memory(op.imm);
+}
+void ld_a16_a(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    cpu.write_memory(op.imm, cpu.A);
+}
+void ldh_a_n(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.A = cpu.read_memory(0xFF00 | op.imm);
+}
+void ldh_n_a(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.write_memory(0xFF00 | op.imm, cpu.A);
+}
+void alu_n(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    op.math(cpu, op.imm);
+}
+void ld_hl_spe(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    uint16_t result = ALU::add_sp_e(cpu, op.imm);
+    cpu.H = result >> 8;
+    cpu.L = result & 0xFF;
+}
+void add_spe(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    cpu.sp = ALU::add_sp_e(cpu, op.imm);
+    cpu.idle_m_cycle();
+}
+//pc already points past the instruction
+void jp(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    if(!op.cc(cpu.flags())) return;
+    cpu.pc = op.imm;
+    cpu.idle_m_cycle();
+}
+void jr(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    if(!op.cc(cpu.flags())) return;
+    cpu.pc = cpu.pc + static_cast<int8_t>(op.imm);
+    cpu.idle_m_cycle();
+}
+void call(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    cpu.idle_m_cycle();
+    if(!op.cc(cpu.flags())) return;
+    cpu.sp--;
+    cpu.write_memory(cpu.sp, cpu.pc >> 8);
+    cpu.sp--;
+    cpu.write_memory(cpu.sp, cpu.pc & 0xFF);
+    cpu.pc = op.imm;
+    cpu.idle_m_cycle();
+}
+
+//prefixed ops spend a second fetch cycle on the real opcode
+template<Handler H>
+void prefixed(CPU& cpu, const DecodedOp& op) {
+    cpu.idle_m_cycle();
+    H(cpu, op);
+}
+void rot_r(CPU& cpu, const DecodedOp& op) {ROT_Inst_r(cpu, op.rot, *op.r1);}
+void rot_m(CPU& cpu, const DecodedOp& op) {ROT_Inst_m(cpu, op.rot);}
+void bit_r(CPU& cpu, const DecodedOp& op) {BIT_r(cpu, *op.r1, op.arg);}
+void bit_m(CPU& cpu, const DecodedOp& op) {BIT_m(cpu, op.arg);}
+void res_r(CPU& cpu, const DecodedOp& op) {RES_r(cpu, *op.r1, op.arg);}
+void res_m(CPU& cpu, const DecodedOp& op) {RES_m(cpu, op.arg);}
+void set_r(CPU& cpu, const DecodedOp& op) {SET_r(cpu, *op.r1, op.arg);}
+void set_m(CPU& cpu, const DecodedOp& op) {SET_m(cpu, op.arg);}
+
+//last address of the cacheable region holding addr, 0 if code there is not cached
+//vram and external ram are left to the interpreter
+unsigned int region_end(uint16_t addr) {
+    if(addr <= Space::ROM_BANK1_END) return Space::ROM_BANK1_END;
+    if(addr <= Space::ROM_BANK2_END) return Space::ROM_BANK2_END;
+    if(addr >= Space::WRAM_START && addr <= Space::WRAM_END) return Space::WRAM_END;
+    if(addr >= Space::ECHO_RAM_START && addr <= Space::ECHO_RAM_END) return Space::ECHO_RAM_END;
+    if(addr >= Space::HRAM_START && addr <= Space::HRAM_END) return Space::HRAM_END;
+    return 0;
+}
+
+constexpr uint16_t ECHO_OFFSET = Space::ECHO_RAM_START - Space::WRAM_START;
+bool in_echo(uint16_t addr) {
+    return addr >= Space::ECHO_RAM_START && addr <= Space::ECHO_RAM_END;
+}
+//echo ram is tracked under the wram page it mirrors
+uint8_t home_page(uint16_t addr) {
+    return (in_echo(addr) ? addr - ECHO_OFFSET : addr) >> 8;
+}
+
+//registers by their opcode index: B C D E H L (HL) A
+constexpr int REG_HL = 6, REG_A = 7;
+constexpr uint8_t bit(int reg) {return 1 << reg;}
+constexpr uint8_t PAIR_BC = bit(0) | bit(1), PAIR_DE = bit(2) | bit(3), PAIR_HL = bit(4) | bit(5);
+
+//checks that ops only move registers and read memory at addresses known
+//when the loop starts, and that the last op jumps back to pc
+IdleLoop find_idle_loop(const std::vector<DecodedOp>& ops, uint16_t pc) {
+    using Base = IdleLoop::Base;
+    IdleLoop loop;
+    if(ops.empty()) return loop;
+
+    uint16_t addr = pc;
+    for(const DecodedOp& op : ops) addr += op.length;
+    const DecodedOp& last = ops.back();
+    bool jr = last.opcode == 0x18 || (last.opcode & 0xE7) == 0x20;
+    bool jp = last.opcode == 0xC3 || (last.opcode & 0xE7) == 0xC2;
+    uint16_t target = jr ? addr + static_cast<int8_t>(last.imm) : last.imm;
+    if(!(jr || jp) || target != pc) return loop;
+
+    uint8_t written = 0;    //registers changed earlier in the pass
+    auto read = [&](Base base, uint16_t at, uint8_t needs) {
+        if((written & needs) || loop.read_count == IdleLoop::MAX_READS) return false;
+        loop.reads[loop.read_count++] = {base, at};
+        return true;
+    };
+    for(size_t i = 0; i + 1 < ops.size(); ++i) {
+        uint16_t code = ops[i].opcode;
+        int dest = (code >> 3) & 7;
+        int src = code & 7;
+        bool ok = true;
+        if(code >= 0xCB00) {
+            //bit tests may read (hl), everything else only on registers
+            bool bit_test = (code & 0xC0) == 0x40;
+            if(src == REG_HL) {
+                ok = bit_test && read(Base::HL, 0, PAIR_HL);
+            } else if(!bit_test) {
+                written |= bit(src);
+            }
+        } else if(code == 0x00 || code == 0x37 || code == 0x3F || code == 0xF3) {
+            //nop, scf, ccf, di
+        } else if(code >= 0x40 && code <= 0x7F) {
+            if(code == 0x76 || dest == REG_HL) {
+                ok = false;     //halt, stores
+            } else {
+                ok = src != REG_HL || read(Base::HL, 0, PAIR_HL);
+                written |= bit(dest);
+            }
+        } else if(code >= 0x80 && code <= 0xBF) {
+            ok = src != REG_HL || read(Base::HL, 0, PAIR_HL);
+            if(dest != 7) written |= bit(REG_A);     //cp only sets flags
+        } else if(code < 0x40 && (src == 4 || src == 5 || src == 6) && dest != REG_HL) {
+            written |= bit(dest);                       //inc r, dec r, ld r,n
+        } else if((code & 0xC7) == 0xC6) {
+            if(code != 0xFE) written |= bit(REG_A);     //alu n
+        } else if(code == 0x07 || code == 0x0F || code == 0x17 || code == 0x1F || code == 0x2F) {
+            written |= bit(REG_A);                      //rotates on a, cpl
+        } else if(code == 0xF0) {
+            ok = read(Base::ABSOLUTE, 0xFF00 | ops[i].imm, 0);
+            written |= bit(REG_A);
+        } else if(code == 0xFA) {
+            ok = read(Base::ABSOLUTE, ops[i].imm, 0);
+            written |= bit(REG_A);
+        } else if(code == 0xF2) {
+            ok = read(Base::HIGH_C, 0, bit(1));
+            written |= bit(REG_A);
+        } else if(code == 0x0A || code == 0x1A) {
+            ok = read(code == 0x0A ? Base::BC : Base::DE, 0, code == 0x0A ? PAIR_BC : PAIR_DE);
+            written |= bit(REG_A);
+        } else {
+            ok = false;
+        }
+        if(!ok) return loop;
+    }
+    loop.candidate = true;
+    return loop;
+}
+}
+
+BlockCache::BlockCache(CPU& cpu, MMU& mmu)
+    :mmu{mmu}
+    {
+        build_tables(cpu);
+        //writes to rom are mbc commands and may switch the bank under a running block
+        std::fill(watched.begin(), watched.begin() + (Space::ROM_END + 1) / 0x100, true);
+    }
+
+void BlockCache::build_tables(CPU& cpu) {
+    using namespace ConditionCode;
+    using namespace Arithmetic;
+
+    uint8_t* regs[] = {&cpu.B, &cpu.C, &cpu.D, &cpu.E, &cpu.H, &cpu.L, nullptr, &cpu.A};
+    auto& op = base_ops;
+    op.fill({.execute = plain<NOP>});
+
+    op[0x01] = {.execute = ld_rr_n16, .r1 = &cpu.B, .r2 = &cpu.C, .length = 3};
+    op[0x02] = {.execute = reg_triple<LD_m_r>, .r1 = &cpu.B, .r2 = &cpu.C, .r3 = &cpu.A};
+    op[0x03] = {.execute = reg_pair<INC_rr>, .r1 = &cpu.B, .r2 = &cpu.C};
+    op[0x07] = {.execute = rot_a, .rot = rot_left_circ};
+    op[0x08] = {.execute = ld_a16_sp, .length = 3};
+    op[0x09] = {.execute = reg_pair<ADD_HL_rr>, .r1 = &cpu.B, .r2 = &cpu.C};
+    op[0x0A] = {.execute = reg_triple<LD_r_m>, .r1 = &cpu.A, .r2 = &cpu.B, .r3 = &cpu.C};
+    op[0x0B] = {.execute = reg_pair<DEC_rr>, .r1 = &cpu.B, .r2 = &cpu.C};
+    op[0x0F] = {.execute = rot_a, .rot = rot_right_circ};
+
+    op[0x11] = {.execute = ld_rr_n16, .r1 = &cpu.D, .r2 = &cpu.E, .length = 3};
+    op[0x12] = {.execute = reg_triple<LD_m_r>, .r1 = &cpu.D, .r2 = &cpu.E, .r3 = &cpu.A};
+    op[0x13] = {.execute = reg_pair<INC_rr>, .r1 = &cpu.D, .r2 = &cpu.E};
+    op[0x17] = {.execute = rot_a, .rot = rot_left};
+    op[0x18] = {.execute = jr, .cc = ALWAYS, .length = 2, .ends_block = true};
+    op[0x19] = {.execute = reg_pair<ADD_HL_rr>, .r1 = &cpu.D, .r2 = &cpu.E};
+    op[0x1A] = {.execute = reg_triple<LD_r_m>, .r1 = &cpu.A, .r2 = &cpu.D, .r3 = &cpu.E};
+    op[0x1B] = {.execute = reg_pair<DEC_rr>, .r1 = &cpu.D, .r2 = &cpu.E};
+    op[0x1F] = {.execute = rot_a, .rot = rot_right};
+
+    op[0x20] = {.execute = jr, .cc = NZ, .length = 2, .ends_block = true};
+    op[0x21] = {.execute = ld_rr_n16, .r1 = &cpu.H, .r2 = &cpu.L, .length = 3};
+    op[0x22] = {.execute = plain<LD_HLinc_A>};
+    op[0x23] = {.execute = reg_pair<INC_rr>, .r1 = &cpu.H, .r2 = &cpu.L};
+    op[0x27] = {.execute = plain<DAA>};
+    op[0x28] = {.execute = jr, .cc = Z, .length = 2, .ends_block = true};
+    op[0x29] = {.execute = reg_pair<ADD_HL_rr>, .r1 = &cpu.H, .r2 = &cpu.L};
+    op[0x2A] = {.execute = plain<LD_A_HLinc>};
+    op[0x2B] = {.execute = reg_pair<DEC_rr>, .r1 = &cpu.H, .r2 = &cpu.L};
+    op[0x2F] = {.execute = plain<CPL>};
+
+    op[0x30] = {.execute = jr, .cc = NC, .length = 2, .ends_block = true};
+    op[0x31] = {.execute = ld_sp_n16, .length = 3};
+    op[0x32] = {.execute = plain<LD_HLdec_A>};
+    op[0x33] = {.execute = plain<INC_SP>};
+    op[0x34] = {.execute = plain<INC_m>};
+    op[0x35] = {.execute = plain<DEC_m>};
+    op[0x36] = {.execute = ld_m_n, .length = 2};
+    op[0x37] = {.execute = plain<SCF>};
+    op[0x38] = {.execute = jr, .cc = C, .length = 2, .ends_block = true};
+    op[0x39] = {.execute = plain<ADD_HL_SP>};
+    op[0x3A] = {.execute = plain<LD_A_HLdec>};
+    op[0x3B] = {.execute = plain<DEC_SP>};
+    op[0x3F] = {.execute = plain<CCF>};
+
+    //INC r, DEC r, LD r,n down the first four rows
+    for(int i = 0; i < 8; ++i) {
+        uint8_t* r = regs[i];
+        op[0x04 + i*8] = r ? DecodedOp{.execute = reg<INC_r>, .r1 = r} : DecodedOp{.execute = plain<INC_m>};
+        op[0x05 + i*8] = r ? DecodedOp{.execute = reg<DEC_r>, .r1 = r} : DecodedOp{.execute = plain<DEC_m>};
+        if(r) {
+            op[0x06 + i*8] = {.execute = ld_r_n, .r1 = r, .length = 2};
+        }
+    }
+
+    for(int code = 0x40; code <= 0x7F; ++code) {
+        uint8_t* dest = regs[(code - 0x40) / 8];
+        uint8_t* src  = regs[code % 8];
+        if(!dest && !src) {
+            op[code] = {.execute = plain<HALT>, .ends_block = true};
+        } else if(!src) {
+            op[code] = {.execute = reg_triple<LD_r_m>, .r1 = dest, .r2 = &cpu.H, .r3 = &cpu.L};
+        } else if(!dest) {
+            op[code] = {.execute = reg_triple<LD_m_r>, .r1 = &cpu.H, .r2 = &cpu.L, .r3 = src};
+        } else {
+            op[code] = {.execute = ld_r_r, .r1 = dest, .r2 = src};
+        }
+    }
+
+    MathOp math_ops[] = {ALU::add_8, ALU::adc_8, ALU::sub_8, ALU::sbc_8,
+                         ALU::and_8, ALU::xor_8, ALU::or_8, ALU::cp_8};
+    for(int code = 0x80; code <= 0xBF; ++code) {
+        MathOp math = math_ops[(code - 0x80) / 8];
+        uint8_t* src = regs[code % 8];
+        op[code] = src ? DecodedOp{.execute = alu_r, .r1 = src, .math = math}
+                       : DecodedOp{.execute = alu_m, .math = math};
+    }
+    for(int i = 0; i < 8; ++i) {
+        op[0xC6 + i*8] = {.execute = alu_n, .math = math_ops[i], .length = 2};
+        op[0xC7 + i*8] = {.execute = rst, .arg = static_cast<uint8_t>(i * 8), .ends_block = true};
+    }
+
+    op[0xC0] = {.execute = ret_if, .cc = NZ, .ends_block = true};
+    op[0xC1] = {.execute = reg_pair<POP_rr>, .r1 = &cpu.B, .r2 = &cpu.C};
+    op[0xC2] = {.execute = jp, .cc = NZ, .length = 3, .ends_block = true};
+    op[0xC3] = {.execute = jp, .cc = ALWAYS, .length = 3, .ends_block = true};
+    op[0xC4] = {.execute = call, .cc = NZ, .length = 3, .ends_block = true};
+    op[0xC5] = {.execute = reg_pair<PUSH_rr>, .r1 = &cpu.B, .r2 = &cpu.C};
+    op[0xC8] = {.execute = ret_if, .cc = Z, .ends_block = true};
+    op[0xC9] = {.execute = plain<RET>, .ends_block = true};
+    op[0xCA] = {.execute = jp, .cc = Z, .length = 3, .ends_block = true};
+    op[0xCC] = {.execute = call, .cc = Z, .length = 3, .ends_block = true};
+    op[0xCD] = {.execute = call, .cc = ALWAYS, .length = 3, .ends_block = true};
+
+    op[0xD0] = {.execute = ret_if, .cc = NC, .ends_block = true};
+    op[0xD1] = {.execute = reg_pair<POP_rr>, .r1 = &cpu.D, .r2 = &cpu.E};
+    op[0xD2] = {.execute = jp, .cc = NC, .length = 3, .ends_block = true};
+    op[0xD4] = {.execute = call, .cc = NC, .length = 3, .ends_block = true};
+    op[0xD5] = {.execute = reg_pair<PUSH_rr>, .r1 = &cpu.D, .r2 = &cpu.E};
+    op[0xD8] = {.execute = ret_if, .cc = C, .ends_block = true};
+    op[0xD9] = {.execute = plain<RETI>, .ends_block = true};
+    op[0xDA] = {.execute = jp, .cc = C, .length = 3, .ends_block = true};
+    op[0xDC] = {.execute = call, .cc = C, .length = 3, .ends_block = true};
+
+    op[0xE0] = {.execute = ldh_n_a, .length = 2};
+    op[0xE1] = {.execute = reg_pair<POP_rr>, .r1 = &cpu.H, .r2 = &cpu.L};
+    op[0xE2] = {.execute = plain<LDH_C_A>};
+    op[0xE5] = {.execute = reg_pair<PUSH_rr>, .r1 = &cpu.H, .r2 = &cpu.L};
+    op[0xE8] = {.execute = add_spe, .length = 2};
+    op[0xE9] = {.execute = plain<JPHL>, .ends_block = true};
+    op[0xEA] = {.execute = ld_a16_a, .length = 3};
+
+    op[0xF0] = {.execute = ldh_a_n, .length = 2};
+    op[0xF1] = {.execute = plain<POP_AF>};
+    op[0xF2] = {.execute = plain<LDH_A_C>};
+    op[0xF3] = {.execute = plain<DI>};
+    op[0xF5] = {.execute = plain<PUSH_AF>};
+    op[0xF8] = {.execute = ld_hl_spe, .length = 2};
+    op[0xF9] = {.execute = plain<LD_SP_HL>};
+    op[0xFA] = {.execute = ld_a_a16, .length = 3};
+    //ei takes effect after the next instruction, which the interpreter runs
+    op[0xFB] = {.execute = plain<EI>, .ends_block = true};
+
+    //0xCB entries are looked up in cb_ops while decoding
+    RotFunc rot_ops[] = {rot_left_circ, rot_right_circ, rot_left, rot_right,
+                         shift_left_arithmetic, shift_right_arithmetic, nullptr, shift_right_logical};
+    for(int code = 0x00; code <= 0xFF; ++code) {
+        uint8_t* r = regs[code % 8];
+        uint8_t group = code / 8;
+        DecodedOp& cb = cb_ops[code];
+        cb = {.r1 = r, .length = 2};
+        if(code < 0x40 && rot_ops[group]) {
+            cb.execute = r ? prefixed<rot_r> : prefixed<rot_m>;
+            cb.rot = rot_ops[group];
+        } else if(code < 0x40) {
+            cb.execute = r ? prefixed<reg<SWAP_r>> : prefixed<plain<SWAP_m>>;
+        } else if(code < 0x80) {
+            cb.execute = r ? prefixed<bit_r> : prefixed<bit_m>;
+            cb.arg = (code - 0x40) / 8;
+        } else if(code < 0xC0) {
+            cb.execute = r ? prefixed<res_r> : prefixed<res_m>;
+            cb.arg = (code - 0x80) / 8;
+        } else {
+            cb.execute = r ? prefixed<set_r> : prefixed<set_m>;
+            cb.arg = (code - 0xC0) / 8;
+        }
+    }
+}
+
+Block** BlockCache::slot(uint16_t pc) {
+    if(pc < Space::ROM_BANK2_START || pc > Space::ROM_BANK2_END) {
+        return &fixed[pc];
+    }
+    uint16_t bank = mmu.rom_bank();
+    if(bank >= banked.size()) {
+        banked.resize(bank + 1);
+    }
+    if(!banked[bank]) {
+        banked[bank] = std::make_unique<std::array<Block*, 0x4000>>();
+        banked[bank]->fill(nullptr);
+    }
+    return &(*banked[bank])[pc - Space::ROM_BANK2_START];
+}
+
+Block* BlockCache::lookup(uint16_t pc) {
+    if(!region_end(pc)) {
+        return nullptr;
+    }
+    Block*& block = *slot(pc);
+    if(!block) {
+        block = &storage.emplace_back();
+    }
+    if(!block->valid) {
+        decode(*block, pc);
+    }
+    bool in_bank = pc >= Space::ROM_BANK2_START && pc <= Space::ROM_BANK2_END;
+    running_banked = in_bank ? block : nullptr;
+    return block->ops.empty() ? nullptr : block;
+}
+
+void BlockCache::decode(Block& block, uint16_t pc) {
+    block.ops.clear();
+    block.native = nullptr;
+    block.hits = 0;
+    unsigned int end = region_end(pc);
+    unsigned int addr = pc;
+    while(block.ops.size() < MAX_BLOCK_OPS) {
+        uint8_t opcode = mmu.read(addr);
+        DecodedOp op = base_ops[opcode];
+        if(opcode == 0xCB) {
+            if(addr + 1 > end) break;
+            op = cb_ops[mmu.read(addr + 1)];
+        }
+        //instructions straddling the end of the region are left to the interpreter
+        if(addr + op.length - 1 > end) break;
+        op.opcode = (opcode == 0xCB) ? (0xCB00 | mmu.read(addr + 1)) : opcode;
+        if(opcode != 0xCB && op.length == 2) {
+            op.imm = mmu.read(addr + 1);
+        } else if(op.length == 3) {
+            op.imm = pair(mmu.read(addr + 2), mmu.read(addr + 1));
+        }
+        block.ops.push_back(op);
+        addr += op.length;
+        if(op.ends_block) break;
+    }
+    block.valid = true;
+    block.idle = find_idle_loop(block.ops, pc);
+    if(!block.ops.empty() && end != Space::ROM_BANK1_END && end != Space::ROM_BANK2_END) {
+        watch(block, pc, addr - 1);
+    }
+}
+
+void BlockCache::watch(Block& block, uint16_t first, uint16_t last) {
+    for(unsigned int addr = first & 0xFF00; addr <= last; addr += 0x100) {
+        uint8_t page = home_page(addr);
+        std::vector<Block*>& blocks = page_blocks[page];
+        if(std::find(blocks.begin(), blocks.end(), &block) == blocks.end()) {
+            blocks.push_back(&block);
+        }
+        set_watch(page, true);
+    }
+}
+
+void BlockCache::set_watch(uint8_t page, bool on) {
+    watched[page] = on;
+    //wram is also written through its echo
+    uint16_t echo = (page << 8) + ECHO_OFFSET;
+    if(page >= (Space::WRAM_START >> 8) && in_echo(echo)) {
+        watched[echo >> 8] = on;
+    }
+}
+
+void BlockCache::invalidate(uint16_t addr) {
+    if(addr <= Space::ROM_END) {
+        //mbc command; rom is intact but the bank under a running block may be gone
+        if(running_banked) {
+            running_banked->valid = false;
+        }
+        return;
+    }
+    if(addr > Space::OAM_RESERVED_END && (addr < Space::HRAM_START || addr > Space::HRAM_END)) {
+        //io registers and IE share a page with hram
+        return;
+    }
+    uint8_t page = home_page(addr);
+    for(Block* block : page_blocks[page]) {
+        block->valid = false;
+    }
+    page_blocks[page].clear();
+    set_watch(page, false);
+}
@@ -1,5 +1,5 @@
 #include <iostream>
-#include <format>
+#include <algorithm>
 #include <memory>
 #include <fstream>
 #include "Arithmetic.h"
@@ -9,6 +9,8 @@
 #include "Instruction.h"
 #include "Memory/InterruptController.h"
 #include "Memory/Spaces.h"
+#include "Profiler.h"
+#include "Jit/Jit.h"
 
 using Arithmetic::pair;
 
@@ -17,13 +19,74 @@ CPU::CPU(Bus& bus, MMU& mmu, InterruptController& interrupt_controller):
     pc{0x100}, sp{0xFFFE},
     A{0x01}, B{0x00}, C{0x13}, D{0x00}, E{0xD8}, H{0x01}, L{0x4D}, F{0xB0},
     bus{bus},
-    interrupt_controller{interrupt_controller}
+    mmu{mmu},
+    interrupt_controller{interrupt_controller},
+    blocks{*this, mmu}
     {
         bus.connect(*this);
     }
 
 CPU::~CPU() = default;
 
+void CPU::set_engine(Engine e) {
+    if(e == Engine::JIT && !jit && Jit::supported()) {
+        jit = std::make_unique<Jit>(*this, bus, mmu, interrupt_controller);
+    }
+    engine = e;
+}
+
+void CPU::save_state(Snapshot& state) const {
+    state = {pc, sp, A, B, C, D, E, H, L, F, IME, cycles, lazy, visit, halted, halt_bug, ei_scheduled};
+}
+
+void CPU::load_state(const Snapshot& state) {
+    pc = state.pc;
+    sp = state.sp;
+    A = state.A; B = state.B; C = state.C; D = state.D;
+    E = state.E; H = state.H; L = state.L; F = state.F;
+    IME = state.IME;
+    cycles = state.cycles;
+    lazy = state.lazy;
+    visit = state.visit;
+    halted = state.halted;
+    halt_bug = state.halt_bug;
+    ei_scheduled = state.ei_scheduled;
+}
+
+void CPU::materialize_flags() {
+    using namespace Arithmetic;
+    uint8_t lhs = lazy.lhs, rhs = lazy.rhs;
+    bool c = lazy.carry;
+    bool z = false, n = false, h = false;
+    switch(lazy.op) {
+        case FlagOp::ADD:
+            z = static_cast<uint8_t>(lhs + rhs + c) == 0;
+            h = half_carry_add_8(lhs, rhs, c);
+            c = lhs + rhs + c > 0xFF;
+            break;
+        case FlagOp::SUB:
+            z = static_cast<uint8_t>(lhs - rhs - c) == 0;
+            n = true;
+            h = half_carry_sub_8(lhs, rhs, c);
+            c = rhs + c > lhs;
+            break;
+        case FlagOp::INC:
+            z = static_cast<uint8_t>(lhs + 1) == 0;
+            h = (lhs & 0xF) == 0xF;
+            break;
+        case FlagOp::DEC:
+            z = static_cast<uint8_t>(lhs - 1) == 0;
+            n = true;
+            h = (lhs & 0xF) == 0;
+            break;
+        case FlagOp::NONE:
+            return;
+    }
+    F = (z << (int)Flag::ZERO) | (n << (int)Flag::NEGATIVE) |
+        (h << (int)Flag::HALF_CARRY) | (c << (int)Flag::CARRY);
+    lazy.op = FlagOp::NONE;
+}
+
 uint8_t CPU::read_memory(uint16_t addr) {
     return bus.read( addr );
 }
@@ -55,6 +118,7 @@ void CPU::halt() {
 }
 
 void CPU::tick() {
+    PROFILE_ZONE(CPU);
     if (interrupt_controller.active()) {
         //there is an interrupt pending
         halted = false; //wake up
@@ -83,11 +147,110 @@ void CPU::tick() {
 
     //fetch and execute
     uint8_t opcode = fetch_byte();
-    if(cb_mode) {
-        cb_mode = false;
-        execute_cb(opcode);
-    } else {
-        execute(opcode);
+    execute(opcode);
+}
+
+void CPU::run(unsigned long until) {
+    PROFILE_ZONE(CPU);
+    if(engine == Engine::INTERPRETER) {
+        while(bus.get_cycles() < until) {
+            if(!skip_halt(until)) {
+                tick();
+            }
+        }
+        return;
+    }
+    //between runs the frontend reads input and may poke memory, none of
+    //which the last visit's stable reads allowed for
+    visit.block = nullptr;
+    while(bus.get_cycles() < until) {
+        if(skip_halt(until)) {
+            continue;
+        }
+        //interrupts, halt, a pending ei and dma stalls are left to the interpreter
+        if(halted || halt_bug || ei_scheduled || bus.dma_active() ||
+           (IME && interrupt_controller.active())) {
+            visit.block = nullptr;
+            tick();
+            continue;
+        }
+        Block* block = blocks.lookup(pc);
+        if(!block) {
+            visit.block = nullptr;
+            tick();
+        } else if(skip_idle_loop(*block, until)) {
+            continue;
+        } else if(engine != Engine::JIT || !jit || !jit->run(*block, pc, until)) {
+            run_block(*block, until);
+        }
+    }
+}
+
+bool CPU::skip_halt(unsigned long until) {
+    //nothing but a scheduled event can end halt, so the cycles up to the
+    //next one would only be idle ticks
+    if(!halted || ei_scheduled || bus.dma_active() || interrupt_controller.active()) {
+        return false;
+    }
+    bus.fast_forward(until);
+    return true;
+}
+
+bool CPU::skip_idle_loop(const Block& block, unsigned long until) {
+    if(!block.idle.candidate) {
+        visit.block = nullptr;
+        return false;
+    }
+    //the loop reads the same values until this horizon
+    unsigned long now = bus.get_cycles();
+    unsigned long horizon = Scheduler::NEVER;
+    for(int i = 0; i < block.idle.read_count; ++i) {
+        const IdleLoop::Read& read = block.idle.reads[i];
+        uint16_t addr = read.addr;
+        switch(read.base) {
+            case IdleLoop::Base::HL: addr = pair(H, L); break;
+            case IdleLoop::Base::BC: addr = pair(B, C); break;
+            case IdleLoop::Base::DE: addr = pair(D, E); break;
+            case IdleLoop::Base::HIGH_C: addr = 0xFF00 | C; break;
+            default: break;
+        }
+        horizon = std::min(horizon, bus.stable_until(addr));
+    }
+    //syncing for the reads may have planned new events
+    horizon = std::min(horizon, bus.next_event());
+
+    //only this block has run since the last visit, so the gap is one pass;
+    //if that pass read what the next ones will and left the registers as
+    //it found them, the next ones do exactly the same
+    LoopVisit arrival{&block, {A, B, C, D, E, H, L, flags()}, sp, IME, now, horizon};
+    bool repeat = visit.block == &block && visit.regs == arrival.regs &&
+                  visit.sp == sp && visit.ime == IME && visit.horizon > now;
+    unsigned long period = now - visit.at;
+    visit = arrival;
+    if(!repeat || period == 0 || horizon <= now) {
+        return false;
+    }
+    //every read of a skipped pass lands before the horizon
+    unsigned long passes = std::min((horizon - now - 1) / period, (until - now) / period);
+    if(passes == 0) {
+        return false;
+    }
+    bus.fast_forward(now + passes * period);
+    visit.at = bus.get_cycles();
+    return true;
+}
+
+void CPU::run_block(const Block& block, unsigned long until) {
+    for(const DecodedOp& op : block.ops) {
+        //opcode fetch; rom and ram reads have no side effects
+        idle_m_cycle();
+        pc += op.length;
+        op.execute(*this, op);
+        //stop at any boundary where the interpreter would do something else
+        if(!block.valid || bus.get_cycles() >= until || bus.dma_active() ||
+           (IME && interrupt_controller.active())) {
+            return;
+        }
     }
 }
 
@@ -108,14 +271,6 @@ void CPU::service_interrupt(Interrupt irq) {
     idle_m_cycle();
 }
 
-namespace ConditionCode {
-    bool NZ(const uint8_t& f) {return !Arithmetic::bit_check(f, (int)Flag::ZERO);}
-    bool Z (const uint8_t& f) {return  Arithmetic::bit_check(f, (int)Flag::ZERO);}
-    bool NC(const uint8_t& f) {return !Arithmetic::bit_check(f, (int)Flag::CARRY);}
-    bool C (const uint8_t& f) {return  Arithmetic::bit_check(f, (int)Flag::CARRY);}
-    bool ALWAYS(const uint8_t& f) {return true;}
-}
-
 void CPU::execute(uint8_t opcode) {
     using namespace Operation;
     switch(opcode) {
@@ -379,7 +534,7 @@ void CPU::execute(uint8_t opcode) {
         case 0xF2: LDH_A_C(*this);                      break;
         case 0xF3: DI(*this);                           break;
         case 0xF4: NOP(*this);                          break;
-        case 0xF5: PUSH_rr(*this, A, F);                break;
+        case 0xF5: PUSH_AF(*this);                      break;
         case 0xF6: ALU_Inst_n(*this, ALU::or_8);        break;
         case 0xF7: RST(*this, 0x30);                    break;
         case 0xF8: LD_HL_SPe(*this);                    break;
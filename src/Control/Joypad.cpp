@@ -1,4 +1,4 @@
-#include "Control/JoyPad.h"
+#include "Control/Joypad.h"
 #include "Memory/MMU.h" 
 #include "Memory/Bus.h"
 #include "Memory/InterruptController.h"
@@ -19,11 +19,13 @@ std::string print_button(InputHandler::Mapping key);
 
 JoyPad::JoyPad(Bus& bus, MMU& mmu, InterruptController& int_controller)
     :data{0xCF},
+     output{mmu.io_register(ADDRESS)},
      ic{int_controller},
      dpad_state{0x0F}, 
      button_state{0x0F}
      {
-        mmu.map_io_register(ADDRESS, this);
+        output = state();
+        mmu.hook_io_write(ADDRESS, this);
         bus.connect(*this);
      }
     
@@ -31,7 +33,7 @@ JoyPad::JoyPad(Bus& bus, MMU& mmu, InterruptController& int_controller)
 void JoyPad::read_input() {   
    if(!ih) return;
 
-   uint8_t old_output = read(ADDRESS);
+   uint8_t old_output = output;
    //reset input state
    dpad_state = 0x0F;
    button_state = 0x0F;
@@ -70,7 +72,8 @@ void JoyPad::read_input() {
        }
     }
 
-   uint8_t new_output = read(ADDRESS);
+   uint8_t new_output = state();
+   output = new_output;
 
    if ((old_output & ~new_output) & 0x0F) {
       //falling edge
@@ -79,7 +82,7 @@ void JoyPad::read_input() {
    }
 }
 
-uint8_t JoyPad::read(uint16_t addr) {
+uint8_t JoyPad::state() const {
    uint8_t output = data | 0xCF;
    
    if (dpad_enabled()) {
@@ -95,6 +98,7 @@ uint8_t JoyPad::read(uint16_t addr) {
 void JoyPad::write(uint16_t addr, uint8_t val) {
    //lower nibble is read-only
    data = (val & 0x30) | (data & 0xCF);
+   output = state();
 }
 
 std::string print_button(InputHandler::Mapping key) {
@@ -1,91 +1,165 @@
-#include "../../include/Graphics/LCD.h" 
-#include <SDL2/SDL.h>
-#include <string>
+#include "Graphics/LCD.h"
+#include <algorithm>
+#include <cstring>
 
-class SDL_error{
-public:
-	SDL_error(std::string message) :msg(message) {}
-	~SDL_error() {}
-	
-	const char* what() const { return msg.c_str(); }
-	
-private:
-	std::string& msg;
-};
+#if defined(__x86_64__) && defined(__GNUC__)
+#define GB5_SIMD_X86
+#include <immintrin.h>
+#endif
 
+namespace {
+    constexpr unsigned int WIDTH = 160;
 
-LCD::LCD(unsigned int window_scale)
-    :scale{window_scale}
-     {
-        init();
-        //std::fill(buffer.begin(), buffer.end(), Color::WHITE);
-     }
-
-void LCD::init() {
-    if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-        throw SDL_error("SDL Init error: " + std::string{SDL_GetError()});
+    uint16_t to_rgb565(uint32_t argb) {
+        return ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F);
     }
 
-    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+#ifdef GB5_SIMD_X86
+    //shades in lanes of any width to colors: every lane equal to a shade
+    //takes its color, KEEP lanes take old
+    template<typename Eq>
+    inline __m128i select(__m128i shades, const __m128i colors[4], __m128i old, Eq eq) {
+        __m128i out = _mm_and_si128(eq(shades, LCD::KEEP), old);
+        for(int shade = 0; shade < 4; ++shade) {
+            out = _mm_or_si128(out, _mm_and_si128(eq(shades, shade), colors[shade]));
+        }
+        return out;
+    }
+    inline __m128i eq_16(__m128i lanes, int val) {return _mm_cmpeq_epi16(lanes, _mm_set1_epi16(val));}
+    inline __m128i eq_32(__m128i lanes, int val) {return _mm_cmpeq_epi32(lanes, _mm_set1_epi32(val));}
+#endif
 
-    //init window
-    window = WindowPtr (
-        SDL_CreateWindow (
-            "gb5",
-            SDL_WINDOWPOS_UNDEFINED,
-            SDL_WINDOWPOS_UNDEFINED,
-            SCREEN_WIDTH * scale,
-            SCREEN_HEIGHT * scale, 
-            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
-        ), 
-        SDL_DestroyWindow
-    );
-    if(!window) {
-        throw SDL_error("SDL Window create error: " + std::string{SDL_GetError()});
+    void line_shade(const uint8_t* shades, uint8_t* line) {
+        unsigned int x = 0;
+#ifdef GB5_SIMD_X86
+        for(; x + 16 <= WIDTH; x += 16) {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shades + x));
+            __m128i* dest = reinterpret_cast<__m128i*>(line + x);
+            __m128i keep = _mm_cmpeq_epi8(in, _mm_set1_epi8(static_cast<char>(LCD::KEEP)));
+            _mm_storeu_si128(dest, _mm_or_si128(_mm_and_si128(keep, _mm_loadu_si128(dest)),
+                                                _mm_andnot_si128(keep, in)));
+        }
+#endif
+        for(; x < WIDTH; ++x) {
+            if(shades[x] != LCD::KEEP) {
+                line[x] = shades[x];
+            }
+        }
     }
 
-    //init renderer
-    renderer = RendererPtr (
-        SDL_CreateRenderer(
-            window.get(), 
-            -1,
-            SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
-        ),
-        SDL_DestroyRenderer
-    );
-    if(!renderer) {
-        throw SDL_error("SDL Renderer create error: " + std::string{SDL_GetError()});
+    void line_shade_2bpp(const uint8_t* shades, uint8_t* line) {
+        for(unsigned int x = 0; x < WIDTH; x += 4) {
+            uint8_t packed = 0;
+            uint8_t keep = 0;
+            for(int i = 0; i < 4; ++i) {
+                int shift = 6 - 2*i;
+                if(shades[x + i] == LCD::KEEP) {
+                    keep |= 0x03 << shift;
+                } else {
+                    packed |= shades[x + i] << shift;
+                }
+            }
+            line[x / 4] = (line[x / 4] & keep) | packed;
+        }
     }
 
-    SDL_RenderSetLogicalSize(renderer.get(), SCREEN_WIDTH, SCREEN_HEIGHT);
-    SDL_RenderSetIntegerScale(renderer.get(), SDL_TRUE);
+    void line_rgb565(const uint8_t* shades, uint16_t* line, const uint32_t palette[4]) {
+        uint16_t colors[4];
+        std::transform(palette, palette + 4, colors, to_rgb565);
+        unsigned int x = 0;
+#ifdef GB5_SIMD_X86
+        const __m128i wide[4] = {
+            _mm_set1_epi16(colors[0]), _mm_set1_epi16(colors[1]),
+            _mm_set1_epi16(colors[2]), _mm_set1_epi16(colors[3]),
+        };
+        const __m128i zero = _mm_setzero_si128();
+        for(; x + 16 <= WIDTH; x += 16) {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shades + x));
+            __m128i half[2] = {_mm_unpacklo_epi8(in, zero), _mm_unpackhi_epi8(in, zero)};
+            for(int i = 0; i < 2; ++i) {
+                __m128i* dest = reinterpret_cast<__m128i*>(line + x + 8*i);
+                _mm_storeu_si128(dest, select(half[i], wide, _mm_loadu_si128(dest), eq_16));
+            }
+        }
+#endif
+        for(; x < WIDTH; ++x) {
+            if(shades[x] != LCD::KEEP) {
+                line[x] = colors[shades[x]];
+            }
+        }
+    }
 
-    //init texture
-    texture = TexturePtr (
-        SDL_CreateTexture (
-            renderer.get(),
-            SDL_PIXELFORMAT_ARGB8888,
-            SDL_TEXTUREACCESS_STREAMING,
-            SCREEN_WIDTH,
-            SCREEN_HEIGHT
-        ),
-        SDL_DestroyTexture
-    );
-    if(!texture) {
-       throw SDL_error("SDL Texture create error: " + std::string{SDL_GetError()}); 
+    void line_argb8888(const uint8_t* shades, uint32_t* line, const uint32_t palette[4]) {
+        unsigned int x = 0;
+#ifdef GB5_SIMD_X86
+        const __m128i wide[4] = {
+            _mm_set1_epi32(palette[0]), _mm_set1_epi32(palette[1]),
+            _mm_set1_epi32(palette[2]), _mm_set1_epi32(palette[3]),
+        };
+        const __m128i zero = _mm_setzero_si128();
+        for(; x + 16 <= WIDTH; x += 16) {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shades + x));
+            __m128i half[2] = {_mm_unpacklo_epi8(in, zero), _mm_unpackhi_epi8(in, zero)};
+            for(int i = 0; i < 4; ++i) {
+                __m128i quarter = (i & 1) ? _mm_unpackhi_epi16(half[i / 2], zero)
+                                          : _mm_unpacklo_epi16(half[i / 2], zero);
+                __m128i* dest = reinterpret_cast<__m128i*>(line + x + 4*i);
+                _mm_storeu_si128(dest, select(quarter, wide, _mm_loadu_si128(dest), eq_32));
+            }
+        }
+#endif
+        for(; x < WIDTH; ++x) {
+            if(shades[x] != LCD::KEEP) {
+                line[x] = palette[shades[x]];
+            }
+        }
     }
+}
 
-    SDL_SetTextureScaleMode(texture.get(), SDL_ScaleModeNearest);
+void LCD::set_format(Format format) {
+    pixel_format = format;
+    buffer.assign(frame_bytes(format), 0);
+    retarget(buffer.data(), nullptr);
 }
 
-void LCD::draw_frame() {
-    SDL_UpdateTexture(
-        texture.get(),
-        nullptr,
-        buffer.data(),
-        SCREEN_WIDTH * sizeof(PixelFormat)
-    );
-    SDL_RenderClear(renderer.get());
-    SDL_RenderCopy(renderer.get(), texture.get(), nullptr, nullptr);
-	SDL_RenderPresent(renderer.get());	
-}
\ No newline at end of file
+void LCD::retarget(uint8_t* frame, const uint8_t* previous_frame) {
+    target = frame;
+    previous = previous_frame;
+    drawn.reset();
+}
+
+void LCD::complete_frame() {
+    if(!previous) {
+        return;
+    }
+    for(unsigned int y = 0; y < SCREEN_HEIGHT; ++y) {
+        if(!drawn[y]) {
+            std::memcpy(target + y * pitch(), previous + y * pitch(), pitch());
+        }
+    }
+    drawn.set();
+}
+
+void LCD::blit_line(const uint8_t* shades, uint8_t y) {
+    static_assert(SCREEN_WIDTH == WIDTH && WIDTH % 4 == 0);
+    uint8_t* line = target + y * pitch();
+    if(previous && !drawn[y] && std::memchr(shades, KEEP, SCREEN_WIDTH)) {
+        //kept pixels have to be the previous frame's
+        std::memcpy(line, previous + y * pitch(), pitch());
+    }
+    drawn.set(y);
+    switch(pixel_format) {
+        case Format::SHADE:
+            line_shade(shades, line);
+            break;
+        case Format::SHADE_2BPP:
+            line_shade_2bpp(shades, line);
+            break;
+        case Format::RGB565:
+            line_rgb565(shades, reinterpret_cast<uint16_t*>(line), color_palette);
+            break;
+        case Format::ARGB8888:
+            line_argb8888(shades, reinterpret_cast<uint32_t*>(line), color_palette);
+            break;
+    }
+}
@@ -6,8 +6,9 @@
 #include "Graphics/LCD.h"
 #include "Graphics/Sprite.h"
 #include "Arithmetic.h"
+#include "Profiler.h"
 #include <iostream>
-#include <format>
+#include <algorithm>
 
 enum StateDots {
     SCANLINE_START = 0, 
@@ -17,6 +18,7 @@ enum StateDots {
     VBLANK_START = 0,
     VBLANK_END = 4559,
     PIXEL_TRANSFER_START = 80,
+    MODE_3_DOTS = 172,
 };
 enum Position {
     VBLANK_LINES = 10,
@@ -26,46 +28,277 @@ enum Position {
 };
 constexpr int SPRITE_BYTES = 4;
 
-uint8_t display_color(uint8_t palette, uint8_t px);
 uint8_t mix_pixel(uint8_t bg_px, SpritePixel spr_px, const PPURegs& regs);
 std::string ppu_state_to_str(PPU::State state);
 
 PPU::PPU(Bus& bus, MMU& mmu, InterruptController& interrupt_controller)
     :vram{mmu},
      oam{mmu},
-     regs{bus, mmu}, 
+     regs{mmu}, 
      mmu{mmu},
      bg_fetcher{vram, regs, bg_fifo},
      spr_fetcher{vram, regs, spr_fifo},
      ic{interrupt_controller},
-     current_state{ oam_scan }
+     bus{bus}
      {
         bg_fetcher.set_position(scanline_x, regs.ly);
         bus.connect(*this);
         bus.oam_dma_dest = &oam;
      }
 
-void PPU::tick() {
+void PPU::save_state(Snapshot& state) const {
+    vram.save_state(state.vram);
+    oam.save_state(state.oam);
+    bg_fetcher.save_state(state.bg_fetcher);
+    spr_fetcher.save_state(state.spr_fetcher);
+    state.spr_buf = spr_buf;
+    state.bg_fifo = bg_fifo;
+    state.spr_fifo = spr_fifo;
+    state.scanline_x = scanline_x;
+    state.line = line;
+    state.line_drawn = line_drawn;
+    state.frame_drawn = frame_drawn;
+    state.oam_counter = oam_counter;
+    state.in_window = in_window;
+    state.cycles = cycles;
+    state.stat_trigger = stat_trigger;
+    state.synced = synced;
+    state.current_state = current_state;
+    state.transfer_end = transfer_end;
+    state.line_bg_fetcher = line_bg_fetcher;
+    state.line_spr_fetcher = line_spr_fetcher;
+    state.line_scx = line_scx;
+    state.line_scy = line_scy;
+}
+
+void PPU::load_state(const Snapshot& state) {
+    vram.load_state(state.vram);
+    oam.load_state(state.oam);
+    regs.reload_shades();
+    bg_fetcher.load_state(state.bg_fetcher);
+    spr_fetcher.load_state(state.spr_fetcher);
+    spr_buf = state.spr_buf;
+    bg_fifo = state.bg_fifo;
+    spr_fifo = state.spr_fifo;
+    scanline_x = state.scanline_x;
+    line = state.line;
+    line_drawn = state.line_drawn;
+    frame_drawn = state.frame_drawn;
+    oam_counter = state.oam_counter;
+    in_window = state.in_window;
+    cycles = state.cycles;
+    stat_trigger = state.stat_trigger;
+    synced = state.synced;
+    current_state = state.current_state;
+    transfer_end = state.transfer_end;
+    line_bg_fetcher = state.line_bg_fetcher;
+    line_spr_fetcher = state.line_spr_fetcher;
+    line_scx = state.line_scx;
+    line_scy = state.line_scy;
+    timed_dots = 0;
+}
+
+void PPU::run(unsigned long dots) {
     //do not tick if PPU switched off
     if(!LCDC::lcd_enable(regs)) {
-        regs.ly = 0;
-        scanline_x = 0;
-        current_state = oam_scan;
-        cycles = OAM_SCAN_START;
-        vram.unblock(mmu);
-        oam.unblock(mmu);
-        STAT::set_mode(regs, STAT::Mode::MODE_0);
+        if(dots > 0) {
+            if(current_state == State::PIXEL_TRANSFER && renderer == Renderer::FIFO) {
+                //keep what was drawn of the line before the lcd went off
+                flush_line();
+            }
+            regs.ly = 0;
+            scanline_x = 0;
+            //the first line after the lcd comes back starts from idle
+            //fetchers, not from wherever the last one left them
+            bg_fetcher.reset();
+            spr_fetcher.stop();
+            spr_fetcher.clear_queue();
+            bg_fifo.clear();
+            spr_fifo.clear();
+            in_window = false;
+            transfer_end = 0;
+            current_state = State::OAM_SCAN;
+            cycles = OAM_SCAN_START;
+            vram.unblock(mmu);
+            oam.unblock(mmu);
+            STAT::set_mode(regs, STAT::Mode::MODE_0);
+        }
         return;
     }
 
-    //execute current state function
-    (this->*current_state)();
+    while(dots > 0) {
+        //each state runs until its next change of state or stat inputs
+        unsigned long done = 0;
+        switch(current_state) {
+            case State::OAM_SCAN:       done = oam_scan(dots);         break;
+            case State::PIXEL_TRANSFER: done = pixel_transfer(dots);   break;
+            case State::H_BLANK:        done = h_blank(dots);          break;
+            case State::V_BLANK:        done = v_blank(dots);          break;
+        }
+        dots -= done;
 
-    //check if stat trigger executed
-    if(stat_trigger.rising_edge(STAT::stat_line(regs))) {
-        ic.request(Interrupt::LCD);
+        //check if stat trigger executed
+        //the stat inputs only change on the first dot of a batch, so
+        //checking once per batch sees the same edges as checking every dot
+        if(stat_trigger.rising_edge(STAT::stat_line(regs))) {
+            ic.request(Interrupt::LCD);
+        }
+    }
+}
+
+void PPU::sync() {
+    PROFILE_ZONE(PPU);
+    unsigned long now = bus.get_cycles();
+    run((now - synced) * 4);
+    synced = now;
+    reschedule();
+}
+
+void PPU::reschedule() {
+    long dots = next_event_dots();
+    if(dots < 0) {
+        bus.cancel(Event::PPU);
+    } else {
+        //an interrupt raised on a dot is visible from the following m-cycle
+        bus.schedule(Event::PPU, synced + dots / 4 + 1);
+    }
+}
+
+long PPU::next_event_dots() const {
+    //dots from the next one to run until the earliest dot that could
+    //raise an interrupt, or -1 if none can
+    if(!LCDC::lcd_enable(regs)) {
+        return -1;
+    }
+    const int HBLANK_EARLIEST = PIXEL_TRANSFER_START + screen->width();
+    bool mode_0_src = STAT::source_enabled(regs, STAT::MODE_0_SELECT);
+    bool mode_2_src = STAT::source_enabled(regs, STAT::MODE_2_SELECT);
+    bool lyc_src    = STAT::source_enabled(regs, STAT::LYC_INT_SELECT);
+
+    if(current_state == State::V_BLANK) {
+        if(cycles == VBLANK_START) return 0;    //vblank interrupt
+        int line_dots = SCANLINE_END + 1;
+        if(lyc_src) {
+            //next ly change
+            return (line_dots - cycles % line_dots) % line_dots;
+        }
+        //end of vblank
+        return std::max(0, VBLANK_END + 1 - cycles);
+    }
+
+    //a stalled pixel transfer can run past the nominal end of the line;
+    //targets already passed are due on the next dot
+    long next = -1;
+    auto consider = [&next](long dots) {
+        dots = std::max(0l, dots);
+        if(next < 0 || dots < next) next = dots;
+    };
+    bool entered_h_blank = (current_state == State::H_BLANK) && ((regs.stat & 0x03) == STAT::MODE_0);
+    if(current_state == State::OAM_SCAN && cycles == OAM_SCAN_START && mode_2_src) {
+        consider(0);
+    }
+    if(mode_0_src && !entered_h_blank) {
+        //pixel transfer length varies; poll from its earliest possible end
+        consider(std::max(HBLANK_EARLIEST, cycles) - cycles);
+    }
+    if(lyc_src) {
+        consider(SCANLINE_END - cycles);
+    }
+    if(mode_0_src || mode_2_src || lyc_src) {
+        consider(SCANLINE_END + 1 - cycles);
+    } else {
+        //nothing happens before vblank
+        consider((screen->height() - 1 - regs.ly) * (SCANLINE_END + 1) + SCANLINE_END + 1 - cycles);
+    }
+    return next;
+}
+
+long PPU::quiet_dots() const {
+    if(!LCDC::lcd_enable(regs)) {
+        //registers stay put once the switched off state has been applied
+        bool applied = regs.ly == 0 && current_state == State::OAM_SCAN &&
+                       cycles == OAM_SCAN_START && (regs.stat & 0x03) == STAT::MODE_0;
+        return applied ? -1 : 0;
+    }
+    constexpr int LINE_DOTS = SCANLINE_END + 1;
+    switch(current_state) {
+        case State::OAM_SCAN:
+            //mode 2 is set on the first dot, mode 3 on the first dot after the scan
+            return (cycles == OAM_SCAN_START) ? 0 : PIXEL_TRANSFER_START - cycles;
+        case State::PIXEL_TRANSFER:
+            if(cycles == PIXEL_TRANSFER_START) return 0;
+            if(renderer == Renderer::SCANLINE && transfer_end != 0) return transfer_end - cycles;
+            //at most one pixel per dot before hblank
+            return screen->width() - scanline_x;
+        case State::H_BLANK:
+            //ly moves on the last dot of the line
+            return ((regs.stat & 0x03) != STAT::MODE_0) ? 0 : SCANLINE_END - cycles;
+        case State::V_BLANK:
+            if(cycles == VBLANK_START || cycles % LINE_DOTS == 0) return 0;
+            return LINE_DOTS - cycles % LINE_DOTS;
+    }
+    return 0;
+}
+
+long PPU::oam_quiet_dots() const {
+    if(!LCDC::lcd_enable(regs)) {
+        return -1;
+    }
+    //sprites are scanned in mode 2 and read through the buffer in mode 3
+    constexpr long VBLANK_DOTS = VBLANK_END + 1;
+    switch(current_state) {
+        case State::OAM_SCAN:
+        case State::PIXEL_TRANSFER:
+            return 0;
+        case State::H_BLANK: {
+            long line = std::max(0, SCANLINE_END - cycles);
+            return (regs.ly == screen->height() - 1) ? line + VBLANK_DOTS : line;
+        }
+        case State::V_BLANK:
+            return VBLANK_DOTS - cycles;
+    }
+    return 0;
+}
+
+void PPU::oam_dma_starting() {
+    //a line the scanline renderer timed ahead assumed its sprites would
+    //stay put
+    if(spr_buf.count() != 0) {
+        untime_line();
     }
-    cycles++;
+}
+
+void PPU::timing_register_writing(uint16_t addr, uint8_t val) {
+    //the fifo's stalls follow lcdc, scx and the window position as they
+    //change, so a line timed ahead with the old values no longer holds
+    uint8_t old = val;
+    switch(addr) {
+        case Space::LCDC:   old = regs.lcdc;    break;
+        case Space::SCX:    old = regs.scx;     break;
+        case Space::WY:     old = regs.wy;      break;
+        case Space::WX:     old = regs.wx;      break;
+        default: break;
+    }
+    if(old != val) {
+        untime_line();
+    }
+}
+
+void PPU::untime_line() {
+    //step the fetchers back up to this dot while the registers still read
+    //as they did for the whole line so far, and keep them going alongside
+    //the bus for the rest of it
+    if(renderer != Renderer::SCANLINE || current_state != State::PIXEL_TRANSFER ||
+       cycles == PIXEL_TRANSFER_START || transfer_end == 0) {
+        return;
+    }
+    bg_fetcher.load_state(line_bg_fetcher);
+    spr_fetcher.load_state(line_spr_fetcher);
+    prep_scanline();
+    for(int dot = PIXEL_TRANSFER_START; dot < cycles; ++dot) {
+        fifo_dot();
+    }
+    transfer_end = 0;
 }
 
 void PPU::check_window_transition() {
@@ -103,6 +336,11 @@ void PPU::prep_scanline() {
     //start from the left
     scanline_x = 0;
     in_window = false;
+    line.fill(LCD::KEEP);
+    //the scanline renderer only runs the fetchers for their timing
+    bool fetch = line_drawn && renderer == Renderer::FIFO;
+    bg_fetcher.set_blank(!fetch);
+    spr_fetcher.set_blank(!fetch);
 
     //reset fetch pipeline
     bg_fetcher.set_mode(PixelFetcher::Mode::BG_FETCH);
@@ -139,16 +377,19 @@ void PPU::advance_scanline() {
     }
 }
 
-void PPU::oam_scan() {  
+unsigned long PPU::oam_scan(unsigned long budget) {  
     //AKA mode 2
-    //std::cout << "STATE: OAM SCAN\n";
     if(cycles == OAM_SCAN_START) {
         STAT::set_mode(regs, STAT::MODE_2);
         oam.block(mmu);
         spr_buf.clear();   //prepare sprite buffer
         oam_counter = 0;
     }
-    if((cycles % 2) == 0) {
+    unsigned long dots = std::min<unsigned long>(budget, OAM_SCAN_END + 1 - cycles);
+    for(unsigned long i = 0; i < dots; ++i, ++cycles) {
+        if((cycles % 2) != 0) {
+            continue;
+        }
         //every 2 dots
         if(!spr_buf.full() && LCDC::obj_enable(regs)) {
             //current sprite
@@ -166,20 +407,74 @@ void PPU::oam_scan() {
         }
         oam_counter++;
     }
-    if(cycles == OAM_SCAN_END) {
-        current_state = pixel_transfer;
-        prep_scanline();
+    if(cycles > OAM_SCAN_END) {
+        current_state = State::PIXEL_TRANSFER;
+        line_drawn = !render_skip;
+        if(renderer == Renderer::FIFO) {
+            prep_scanline();
+        }
     }
+    return dots;
 }
 
-void PPU::pixel_transfer() {
+unsigned long PPU::pixel_transfer(unsigned long budget) {
     //AKA mode 3
-    //std::cout << "STATE: PIXEL TRANSFER\n";
     if(cycles == PIXEL_TRANSFER_START) {
         STAT::set_mode(regs, STAT::MODE_3);
         vram.block(mmu);
+        if(renderer == Renderer::SCANLINE) {
+            int dots = scanline_transfer_dots();
+            transfer_end = (dots != 0) ? PIXEL_TRANSFER_START + dots : 0;
+            line_scx = regs.scx;
+            line_scy = regs.scy;
+        }
     }
-    
+    if(renderer == Renderer::SCANLINE) {
+        unsigned long dots = 0;
+        bool done = false;
+        if(transfer_end != 0) {
+            dots = std::min<unsigned long>(budget, transfer_end - cycles);
+            cycles += dots;
+            done = (cycles == transfer_end);
+        } else {
+            while(dots < budget && !done) {
+                done = fifo_dot();
+                cycles++;
+                dots++;
+            }
+        }
+        if(done) {
+            if(line_drawn) {
+                render_scanline();
+            }
+            scanline_x = screen->width();
+            current_state = State::H_BLANK;
+            vram.unblock(mmu);
+            oam.unblock(mmu);
+        }
+        return dots;
+    }
+    //the fetchers have to be stepped dot by dot
+    unsigned long dots = 0;
+    while(dots < budget && current_state == State::PIXEL_TRANSFER) {
+        pixel_transfer_dot();
+        cycles++;
+        dots++;
+    }
+    return dots;
+}
+
+void PPU::pixel_transfer_dot() {
+    if(fifo_dot()) {
+        //end of line
+        flush_line();
+        current_state = State::H_BLANK;
+        vram.unblock(mmu);
+        oam.unblock(mmu);
+    }
+}
+
+bool PPU::fifo_dot() {
     if(!spr_fetcher.active()) {
         bg_fetcher.tick();
         if(!bg_fetcher.active()) {
@@ -199,7 +494,7 @@ void PPU::pixel_transfer() {
     }
 
     if(bg_fifo.empty()) {
-        return;
+        return false;
     }
 
     int pos = scanline_x - regs.scx % 8;
@@ -208,93 +503,219 @@ void PPU::pixel_transfer() {
     if(!spr_fifo.empty() && (scanline_x == spr_fifo.front().x - SCREEN_X_OFFSET)) {
         spr_px = spr_fifo.pop();
     }
-    uint8_t display_px = mix_pixel(bg_px, spr_px, regs);
-
     // pos < 0 means there are pixels in the FIFO "behind" the screen
-    if(pos >= 0 && screen != nullptr) {
+    if(pos >= 0 && line_drawn && renderer == Renderer::FIFO) {
         //reached left edge of screen
-        screen->blit(display_px, pos, regs.ly);
+        line[pos] = mix_pixel(bg_px, spr_px, regs);
     }
     
     advance_scanline();
+    return scanline_x >= screen->width();
+}
 
-    if(scanline_x >= screen->width()) {
-        //end of line
-        current_state = h_blank;
-        vram.unblock(mmu);
-        oam.unblock(mmu);
+PPU::FetchStalls PPU::fetch_stalls() const {
+    FetchStalls stalls;
+    stalls.obj_enable = LCDC::obj_enable(regs);
+    stalls.spr_count = spr_buf.count();
+    for(int i = 0; i < spr_buf.count(); ++i) {
+        stalls.spr_x[i] = spr_buf.at(i).x();
+    }
+    stalls.win_x = window_on_line() ? regs.wx : -1;
+    return stalls;
+}
+
+int PPU::scanline_transfer_dots() {
+    //mode 3 has to last as long as the fifo's would, which is MODE_3_DOTS
+    //unless a sprite or the window stalls its fetchers. 0 means the
+    //fetchers have to time this line alongside the bus
+
+    //kept so a register write or dma later in the line can replay the
+    //fetchers from where the fifo's would have started
+    bg_fetcher.save_state(line_bg_fetcher);
+    spr_fetcher.save_state(line_spr_fetcher);
+    bool idle_before = bg_fetcher.active() && !bg_fetcher.stop_requested() && !spr_fetcher.active();
+    if(idle_before && spr_buf.count() == 0 && !window_on_line()) {
+        //nothing to stall on, and the fetchers end the line as they began
+        return MODE_3_DOTS;
+    }
+    if(bus.dma_active()) {
+        //dma rewrites the oam entries the buffered sprites point to
+        prep_scanline();
+        return 0;
     }
+    //oam is blocked until hblank, so only mid-line register writes could
+    //change the stalls from here on
+    FetchStalls stalls = fetch_stalls();
+    if(idle_before && timed_dots != 0 && stalls == timed_stalls) {
+        return timed_dots;
+    }
+    //step the blank fetchers through the whole line now
+    prep_scanline();
+    int dots = 1;
+    while(!fifo_dot()) {
+        dots++;
+    }
+    //a line that starts and ends idle takes the same time on every line
+    //with the same stalls
+    bool idle_after = bg_fetcher.active() && !bg_fetcher.stop_requested() && !spr_fetcher.active();
+    timed_stalls = stalls;
+    timed_dots = (idle_before && idle_after) ? dots : 0;
+    return dots;
 }
 
-void PPU::h_blank() {
+unsigned long PPU::h_blank(unsigned long budget) {
     //AKA mode 0
-    //std::cout << "STATE: H BLANK\n";
     if(scanline_x == screen->width()) {
         //first dot of HBLANK
         STAT::set_mode(regs, STAT::MODE_0);
     }
     if(cycles < SCANLINE_END) {
         //do nothing until dot number 455
-        return;
+        unsigned long dots = std::min<unsigned long>(budget, SCANLINE_END - cycles);
+        cycles += dots;
+        return dots;
     }
 
     //start next oam scan
     go_next_scanline();
-    cycles = OAM_SCAN_START - 1;
-    current_state = oam_scan;
+    cycles = OAM_SCAN_START;
+    current_state = State::OAM_SCAN;
 
     if(regs.ly == screen->height()) {
         //if next scanline is off-screen
-        cycles = VBLANK_START - 1;
-        current_state = v_blank;
+        cycles = VBLANK_START;
+        current_state = State::V_BLANK;
     }
+    return 1;
 }
 
-void PPU::v_blank() {
+unsigned long PPU::v_blank(unsigned long budget) {
     //AKA mode 1
-    //std::cout <<"STATE: VBLANK\n";
     if(cycles == VBLANK_START) {
         //first dot of V BLANK
         STAT::set_mode(regs, STAT::MODE_1);
         ic.request(Interrupt::VBLANK);
-        return;
+        if(frame_drawn && screen != nullptr) {
+            screen->frame_ready();
+        }
+        frame_drawn = false;
+        cycles++;
+        return 1;
     }
 
-    if(cycles % (SCANLINE_END+1) == 0) {
-        go_next_scanline();
+    constexpr int LINE_DOTS = SCANLINE_END + 1;
+    if(cycles % LINE_DOTS != 0) {
+        //nothing happens until the next line
+        unsigned long dots = std::min<unsigned long>(budget, LINE_DOTS - cycles % LINE_DOTS);
+        cycles += dots;
+        return dots;
+    }
 
-        if(regs.ly == 0) {
-            //looped back to start of screen
-            cycles = OAM_SCAN_START - 1;
-            current_state = oam_scan;
-        }
+    go_next_scanline();
+    cycles++;
+    if(regs.ly == 0) {
+        //looped back to start of screen
+        cycles = OAM_SCAN_START;
+        current_state = State::OAM_SCAN;
     }
+    return 1;
 }
 
-uint8_t display_color(uint8_t palette, uint8_t px) {
-    if(px > 0x03) return 0;
-    return (palette >> (2*px)) & (uint8_t)3;
+bool PPU::window_on_line() const {
+    //the fifo switches to the window once x passes wx-7, up to x = width
+    return LCDC::win_enable(regs) && regs.ly >= regs.wy && regs.wx <= screen->width() + 7;
 }
 
-uint8_t mix_pixel(uint8_t bg_px, SpritePixel spr_px, const PPURegs& regs) {
-    Sprite::Priority prio = spr_px.priority;
-    Sprite::Palette pal = spr_px.palette;
-    uint8_t color = 0;
+void PPU::render_scanline() {
+    //draws the whole line with the registers as they are now. unlike the
+    //fifo, fine scroll does not shift sprites or leave the right edge
+    //undrawn, and the window starts exactly at wx-7
+    const int width = screen->width();
+    const uint8_t ly = regs.ly;
+    using VRAM::AddressMode::SIGNED;
+    using VRAM::AddressMode::UNSIGNED;
+    VRAM::AddressMode mode = LCDC::bg_tile_area(regs) ? UNSIGNED : SIGNED;
+
+    //background and window color indices
+    std::array<uint8_t, 256> bg{};
+    int win_start = window_on_line() ? std::max(0, regs.wx - 7) : width;
+    uint16_t bg_map = LCDC::bg_tilemap(regs) ? Space::TILEMAP_1 : Space::TILEMAP_0;
+    uint8_t bg_y = ly + line_scy;
+    for(int x = 0; x < win_start; ) {
+        uint8_t bg_x = x + line_scx;
+        uint16_t tile = vram.tile_number(vram.read(bg_map + (bg_y / 8) * 0x20 + bg_x / 8), mode);
+        const VRAM::TileRow& row = vram.tile_row(tile, bg_y % 8);
+        for(int px = bg_x % 8; px < 8 && x < win_start; ++px, ++x) {
+            bg[x] = row[px];
+        }
+    }
+    uint16_t win_map = LCDC::win_tilemap(regs) ? Space::TILEMAP_1 : Space::TILEMAP_0;
+    uint8_t win_y = ly - regs.wy;
+    for(int x = win_start; x < width; ) {
+        int win_x = x - win_start;
+        uint16_t tile = vram.tile_number(vram.read(win_map + (win_y / 8) * 0x20 + win_x / 8), mode);
+        const VRAM::TileRow& row = vram.tile_row(tile, win_y % 8);
+        for(int px = 0; px < 8 && x < width; ++px, ++x) {
+            bg[x] = row[px];
+        }
+    }
 
-    if(!spr_px.color || !LCDC::obj_enable(regs)) {
-        color = display_color(regs.bgp, bg_px);
-    } else if(prio == Sprite::Priority::BACK && bg_px) {
-        color = display_color(regs.bgp, bg_px);
-    } else {
-        switch(pal) {
-            case Sprite::Palette::OBP0:
-                color = display_color(regs.obp_0, spr_px.color);
-                break;
-            case Sprite::Palette::OBP1:
-                color = display_color(regs.obp_1, spr_px.color);
-                break;
+    //sprites: the one with the lowest x wins a pixel, then the earliest in
+    //oam; a transparent pixel lets the next sprite through
+    std::array<SpritePixel, 256> spr{};
+    if(LCDC::obj_enable(regs)) {
+        std::array<uint8_t, 10> order;
+        for(uint8_t i = 0; i < spr_buf.count(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.begin() + spr_buf.count(), [this](uint8_t a, uint8_t b) {
+            return spr_buf.at(a).x() < spr_buf.at(b).x();
+        });
+        uint8_t spr_height = BASE_SPR_HEIGHT + BASE_SPR_HEIGHT*LCDC::obj_size(regs);
+        for(uint8_t n = 0; n < spr_buf.count(); ++n) {
+            const Sprite& sprite = spr_buf.at(order[n]);
+            uint8_t row = ly - sprite.y() + SCREEN_Y_OFFSET;
+            if(sprite.y_flip()) {
+                row = (spr_height - 1) - row;
+            }
+            uint8_t index = sprite.index();
+            if(spr_height == 16) {
+                index &= 0xFE;
+            }
+            //rows past the sprite only happen if oam changed since the scan
+            const VRAM::TileRow& pixels = vram.tile_row(index + row / 8, row % 8, sprite.x_flip());
+            for(int i = 0; i < 8; ++i) {
+                int x = sprite.x() - SCREEN_X_OFFSET + i;
+                if(x < 0 || x >= width || spr[x].color) {
+                    continue;
+                }
+                SpritePixel& px = spr[x];
+                px.color = pixels[i];
+                px.palette = sprite.palette();
+                px.priority = sprite.priority();
+            }
         }
     }
 
-    return color;
-}
\ No newline at end of file
+    for(int x = 0; x < width; ++x) {
+        line[x] = mix_pixel(bg[x], spr[x], regs);
+    }
+    flush_line();
+}
+
+void PPU::flush_line() {
+    if(screen != nullptr && line_drawn) {
+        screen->blit_line(line.data(), regs.ly);
+        frame_drawn = true;
+    }
+}
+
+uint8_t mix_pixel(uint8_t bg_px, SpritePixel spr_px, const PPURegs& regs) {
+    if(!spr_px.color || !LCDC::obj_enable(regs)) {
+        return regs.shade(PPURegs::BG_PALETTE, bg_px);
+    }
+    if(spr_px.priority == Sprite::Priority::BACK && bg_px) {
+        return regs.shade(PPURegs::BG_PALETTE, bg_px);
+    }
+    PPURegs::Palette palette = (spr_px.palette == Sprite::Palette::OBP0) ? PPURegs::OBJ_PALETTE_0
+                                                                         : PPURegs::OBJ_PALETTE_1;
+    return regs.shade(palette, spr_px.color);
+}
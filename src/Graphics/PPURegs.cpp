@@ -1,13 +1,27 @@
 #include "Graphics/PPURegs.h" 
 #include "Memory/MMU.h" 
 #include "Memory/Spaces.h"
-#include "Memory/Bus.h"
 
 
-PPURegs::PPURegs(Bus& bus, MMU& mmu) 
-    :bus{bus}
+PPURegs::PPURegs(MMU& mmu) 
+    :lcdc {mmu.io_register(Space::LCDC)},
+     stat {mmu.io_register(Space::STAT)},
+     scy  {mmu.io_register(Space::SCY)},
+     scx  {mmu.io_register(Space::SCX)},
+     ly   {mmu.io_register(Space::LY)},
+     lyc  {mmu.io_register(Space::LYC)},
+     dma  {mmu.io_register(Space::DMA)},
+     bgp  {mmu.io_register(Space::BGP)},
+     obp_0{mmu.io_register(Space::OBP0)},
+     obp_1{mmu.io_register(Space::OBP1)},
+     wy   {mmu.io_register(Space::WY)},
+     wx   {mmu.io_register(Space::WX)}
     {
-        mmu.map_io_region(START, END, this);
+        mmu.hook_io_write(Space::STAT, this);
+        mmu.hook_io_write(Space::LY, this);
+        mmu.hook_io_write(Space::BGP, this);
+        mmu.hook_io_write(Space::OBP0, this);
+        mmu.hook_io_write(Space::OBP1, this);
         //defaults
         lcdc    = 0x91;
         stat    = 0x85;
@@ -21,47 +35,32 @@ PPURegs::PPURegs(Bus& bus, MMU& mmu)
         obp_1   = 0xE4;
         wy      = 0x00;
         wx      = 0x00;
-
+        reload_shades();
     }
 
-uint8_t PPURegs::read(uint16_t addr) {
-    switch(addr) {
-        case Space::LCDC: return lcdc;
-        case Space::STAT: return stat;
-        case Space::SCY : return scy;
-        case Space::SCX : return scx;
-        case Space::LY  : return ly;
-        case Space::LYC : return lyc;
-        case Space::DMA : return dma;
-        case Space::BGP : return bgp;
-        case Space::OBP0: return obp_0;
-        case Space::OBP1: return obp_1;
-        case Space::WY  : return wy;
-        case Space::WX  : return wx;
-        default: return 0xFF;
-    }
-}
 void PPURegs::write(uint16_t addr, uint8_t val) {
     switch(addr) {
-        case Space::LCDC: lcdc  = val;  break;
         case Space::STAT: stat = ((val & ~0x03) | (stat & 0x03)); break;
-        case Space::SCY : scy   = val;  break;
-        case Space::SCX : scx   = val;  break;
         case Space::LY  : break; //read only
-        case Space::LYC : lyc   = val;  break;
-        case Space::DMA :
-            dma = val;
-            bus.start_dma(val);
-            break;
-        case Space::BGP : bgp   = val;  break;
-        case Space::OBP0: obp_0 = val;  break;
-        case Space::OBP1: obp_1 = val;  break;
-        case Space::WY  : wy    = val;  break;
-        case Space::WX  : wx    = val;  break;
+        case Space::BGP : bgp   = val; update_shades(BG_PALETTE, val); break;
+        case Space::OBP0: obp_0 = val; update_shades(OBJ_PALETTE_0, val); break;
+        case Space::OBP1: obp_1 = val; update_shades(OBJ_PALETTE_1, val); break;
         default: break;
     }
 }
 
+void PPURegs::reload_shades() {
+    update_shades(BG_PALETTE, bgp);
+    update_shades(OBJ_PALETTE_0, obp_0);
+    update_shades(OBJ_PALETTE_1, obp_1);
+}
+
+void PPURegs::update_shades(Palette palette, uint8_t val) {
+    for(uint8_t color = 0; color < 4; ++color) {
+        shades[palette][color] = (val >> (2*color)) & 0x03;
+    }
+}
+
 namespace STAT {
     bool stat_line(const PPURegs& regs) {
         uint8_t mode = regs.stat & 0x03;    
@@ -6,7 +6,6 @@
 #include "Memory/Spaces.h"
 
 #include <iostream>
-#include <format>
 
 //state starting cycles
 constexpr int INIT_START = 0;
@@ -20,7 +19,7 @@ std::string fetcher_state_to_str(PixelFetcher::State);
 PixelFetcher::PixelFetcher(const VRAM& vram, const PPURegs& control, BgFifo& fifo) 
     : on{true},
       vram{vram}, regs{control}, fifo{fifo},
-      curr_state{ init }
+      curr_state{ &PixelFetcher::init }
     {}
 
 void PixelFetcher::tick() {
@@ -34,7 +33,7 @@ void PixelFetcher::init() {
     if(cycles < GET_INDEX_START - 1) {
         return;
     }
-    curr_state = get_tile_index;
+    curr_state = &PixelFetcher::get_tile_index;
 
     //wait for init to finish before checking stop
     if(stop_pending) {
@@ -62,9 +61,11 @@ void PixelFetcher::get_tile_index() {
         default: break;
     } 
 
-    tile_index = vram.read(map + tile_y*0x20 + x_pos);
+    if(!blank) {
+        tile_index = vram.read(map + tile_y*0x20 + x_pos);
+    }
 
-    curr_state = get_tile;
+    curr_state = &PixelFetcher::get_tile;
 
     if(stop_pending) {
         on = false;
@@ -82,9 +83,9 @@ void PixelFetcher::get_tile() {
     using VRAM::AddressMode::UNSIGNED;
     VRAM::AddressMode mode = LCDC::bg_tile_area(regs) ? UNSIGNED : SIGNED;
 
-    tile_data = vram.tile_at(tile_index, mode);
+    tile_number = vram.tile_number(tile_index, mode);
 
-    curr_state = get_tile_line;
+    curr_state = &PixelFetcher::get_tile_line;
 
     if(stop_pending) {
         on = false;
@@ -97,12 +98,12 @@ void PixelFetcher::get_tile_line() {
     }
 
     //third step in fetch pipeline (2 dots)
-    uint8_t row = y_pos % 8;    //row of tile
-    for(size_t px = 0; px < px_buf.size(); ++px) {
-        px_buf[px_buf.size()-1 - px] = tile_data.get_pixel(px, row);
+    //px_buf stays cleared from the last push on a blank fetch
+    if(!blank) {
+        px_buf = vram.tile_row(tile_number, y_pos % 8);
     }
 
-    curr_state = push_to_fifo;
+    curr_state = &PixelFetcher::push_to_fifo;
 
     if(stop_pending) {
         on = false;
@@ -125,14 +126,14 @@ void PixelFetcher::push_to_fifo(){
 
 void PixelFetcher::reset_fetch() {
     cycles = GET_INDEX_START - 1;
-    curr_state = get_tile_index;
+    curr_state = &PixelFetcher::get_tile_index;
     std::fill(px_buf.begin(), px_buf.end(), 0);
 }
 
 void PixelFetcher::set_mode(Mode mode) {
     curr_mode = mode;
     std::fill(px_buf.begin(), px_buf.end(), 0);
-    curr_state = init;
+    curr_state = &PixelFetcher::init;
     cycles = INIT_START;
 }
 
@@ -162,10 +163,16 @@ void PixelFetcher::start() {
 }
 
 void PixelFetcher::request_stop() {
-    if(curr_state == &push_to_fifo) {
+    if(curr_state == &PixelFetcher::push_to_fifo) {
         on = false; //stop right away
     } else {
         //wait until done with VRAM bus
         stop_pending = true;
     }
-}
\ No newline at end of file
+}
+
+void PixelFetcher::reset() {
+    on = true;
+    stop_pending = false;
+    set_mode(Mode::BG_FETCH);
+}
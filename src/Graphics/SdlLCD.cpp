@@ -0,0 +1,128 @@
+#include "Graphics/SdlLCD.h"
+#include <SDL2/SDL.h>
+#include <string>
+#include <stdexcept>
+
+class SDL_error{
+public:
+	SDL_error(std::string message) :msg(message) {}
+	~SDL_error() {}
+	
+	const char* what() const { return msg.c_str(); }
+	
+private:
+	std::string msg;
+};
+
+
+SdlLCD::SdlLCD(unsigned int window_scale)
+    :scale{window_scale}
+     {
+        init();
+        reset_frames();
+     }
+
+void SdlLCD::init() {
+    if(SDL_Init(SDL_INIT_VIDEO) < 0) {
+        throw SDL_error("SDL Init error: " + std::string{SDL_GetError()});
+    }
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+
+    //init window
+    window = WindowPtr (
+        SDL_CreateWindow (
+            "gb5",
+            SDL_WINDOWPOS_UNDEFINED,
+            SDL_WINDOWPOS_UNDEFINED,
+            SCREEN_WIDTH * scale,
+            SCREEN_HEIGHT * scale, 
+            SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
+        ), 
+        SDL_DestroyWindow
+    );
+    if(!window) {
+        throw SDL_error("SDL Window create error: " + std::string{SDL_GetError()});
+    }
+
+    //init renderer
+    renderer = RendererPtr (
+        SDL_CreateRenderer(
+            window.get(), 
+            -1,
+            SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+        ),
+        SDL_DestroyRenderer
+    );
+    if(!renderer) {
+        throw SDL_error("SDL Renderer create error: " + std::string{SDL_GetError()});
+    }
+
+    SDL_RenderSetLogicalSize(renderer.get(), SCREEN_WIDTH, SCREEN_HEIGHT);
+    SDL_RenderSetIntegerScale(renderer.get(), SDL_TRUE);
+
+    create_texture();
+}
+
+void SdlLCD::create_texture() {
+    texture = TexturePtr (
+        SDL_CreateTexture (
+            renderer.get(),
+            (format() == Format::RGB565) ? SDL_PIXELFORMAT_RGB565 : SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            SCREEN_WIDTH,
+            SCREEN_HEIGHT
+        ),
+        SDL_DestroyTexture
+    );
+    if(!texture) {
+       throw SDL_error("SDL Texture create error: " + std::string{SDL_GetError()}); 
+    }
+
+    SDL_SetTextureScaleMode(texture.get(), SDL_ScaleModeNearest);
+}
+
+void SdlLCD::reset_frames() {
+    //every slot starts as a copy of the frame so far, then the ppu draws
+    //straight into the back slot
+    frames.fill(buffer);
+    retarget(frames.back_slot().data(), nullptr);
+}
+
+void SdlLCD::set_format(Format format) {
+    if(format != Format::RGB565 && format != Format::ARGB8888) {
+        throw std::invalid_argument("SDL display needs an RGB565 or ARGB8888 frame buffer");
+    }
+    LCD::set_format(format);
+    create_texture();
+    reset_frames();
+}
+
+void SdlLCD::frame_ready() {
+    complete_frame();
+    const uint8_t* finished = target;
+    frames.publish();
+    retarget(frames.back_slot().data(), finished);
+}
+
+bool SdlLCD::present() {
+    if(!frames.take()) {
+        //nothing new since the last present
+        return false;
+    }
+    SDL_UpdateTexture(
+        texture.get(),
+        nullptr,
+        frames.front_slot().data(),
+        static_cast<int>(pitch())
+    );
+    SDL_RenderClear(renderer.get());
+    SDL_RenderCopy(renderer.get(), texture.get(), nullptr, nullptr);
+    //blocks until vsync; frames finished meanwhile replace each other
+    SDL_RenderPresent(renderer.get());
+    return true;
+}
+
+void SdlLCD::set_title(const std::string& title) {
+    SDL_SetWindowTitle(window.get(), title.c_str());
+}
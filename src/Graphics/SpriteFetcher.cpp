@@ -3,7 +3,6 @@
 #include "Graphics/PPURegs.h"   
 #include "Memory/Spaces.h"   
 #include <iostream>
-#include <format>
 
 constexpr int GET_ID_START = 0;
 constexpr int GET_ROW_START = 1;
@@ -22,7 +21,7 @@ void SpriteFetcher::start() {
     }
     on = true;
     cycles = GET_ID_START;
-    curr_state = get_tile_index;
+    curr_state = &SpriteFetcher::get_tile_index;
 
     (this->*curr_state)();
     cycles++;
@@ -31,14 +30,14 @@ void SpriteFetcher::start() {
 void SpriteFetcher::stop() {
     //spr_queue.front() = nullptr;
     cycles = GET_ID_START;
-    curr_state = get_tile_index;
+    curr_state = &SpriteFetcher::get_tile_index;
 
     on = false;
 }
 
 void SpriteFetcher::reset_fetch() {
     cycles = GET_ID_START - 1;
-    curr_state = get_tile_index;
+    curr_state = &SpriteFetcher::get_tile_index;
     std::fill(px_buf.begin(), px_buf.end(), 0);
     
     on = true;
@@ -54,7 +53,7 @@ void SpriteFetcher::tick()  {
 void SpriteFetcher::get_tile_index() {
     tile_index = spr_queue.front().index();
 
-    curr_state = get_row;
+    curr_state = &SpriteFetcher::get_row;
 }
 
 void SpriteFetcher::get_row() {
@@ -84,19 +83,21 @@ void SpriteFetcher::get_row() {
     }
     //the tile data block is fixed. No need to do anything in second dot
     if(cycles == GET_LINE_START - 1) {
-        curr_state = get_tile_line;
+        curr_state = &SpriteFetcher::get_tile_line;
     }
     return;
 }
 
 void SpriteFetcher::get_tile_line() {
-    //objects always use unsigned addressing
-    Tile tile_data = vram.tile_at(tile_index, VRAM::AddressMode::UNSIGNED);
-    for(size_t px = 0; px < px_buf.size(); ++px) {
-        px_buf[px_buf.size()-1 - px] = tile_data.get_pixel(px, row);
+    //objects always use unsigned addressing. the flip attribute is only
+    //read when the pixels are pushed, so keep the row as stored.
+    //row is only out of range if oam changed since the scan; the fetch
+    //then runs on into the following tiles
+    if(!blank) {
+        px_buf = vram.tile_row(tile_index + row / 8, row % 8);
     }
 
-    curr_state = push_to_fifo;
+    curr_state = &SpriteFetcher::push_to_fifo;
 }
 
 void SpriteFetcher::push_to_fifo() {
@@ -0,0 +1,136 @@
+#include "Graphics/TileDecode.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define GB5_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace TileDecode {
+
+void rows_scalar(const uint8_t* planes, size_t count, uint8_t* pixels, bool x_flip) {
+    for(size_t row = 0; row < count; ++row) {
+        uint8_t lo = planes[2*row];
+        uint8_t hi = planes[2*row + 1];
+        for(int px = 0; px < 8; ++px) {
+            int bit = x_flip ? px : 7 - px;
+            pixels[8*row + px] = (((hi >> bit) & 1) << 1) | ((lo >> bit) & 1);
+        }
+    }
+}
+
+#ifdef GB5_SIMD_X86
+namespace {
+    //the bit each output byte tests, per row of 8 pixels
+    constexpr uint64_t LEFT_FIRST  = 0x0102040810204080ull;
+    constexpr uint64_t RIGHT_FIRST = 0x8040201008040201ull;
+
+    //planes of rows 0-7 in; out: the lo planes of 2 rows per vector with
+    //every byte repeated 8 times, then the hi planes the same way
+    inline void spread_8(__m128i planes, __m128i out[8]) {
+        //split the interleaved planes, then repeat every byte 8 times
+        __m128i lo = _mm_packus_epi16(_mm_and_si128(planes, _mm_set1_epi16(0x00FF)), _mm_setzero_si128());
+        __m128i hi = _mm_packus_epi16(_mm_srli_epi16(planes, 8), _mm_setzero_si128());
+        __m128i lo_2 = _mm_unpacklo_epi8(lo, lo);
+        __m128i hi_2 = _mm_unpacklo_epi8(hi, hi);
+        __m128i lo_4[2] = {_mm_unpacklo_epi16(lo_2, lo_2), _mm_unpackhi_epi16(lo_2, lo_2)};
+        __m128i hi_4[2] = {_mm_unpacklo_epi16(hi_2, hi_2), _mm_unpackhi_epi16(hi_2, hi_2)};
+        for(int i = 0; i < 2; ++i) {
+            out[2*i]     = _mm_unpacklo_epi32(lo_4[i], lo_4[i]);
+            out[2*i + 1] = _mm_unpackhi_epi32(lo_4[i], lo_4[i]);
+            out[4 + 2*i]     = _mm_unpacklo_epi32(hi_4[i], hi_4[i]);
+            out[4 + 2*i + 1] = _mm_unpackhi_epi32(hi_4[i], hi_4[i]);
+        }
+    }
+
+    inline __m128i pixels_sse2(__m128i lo, __m128i hi, __m128i mask) {
+        __m128i lo_set = _mm_cmpeq_epi8(_mm_and_si128(lo, mask), mask);
+        __m128i hi_set = _mm_cmpeq_epi8(_mm_and_si128(hi, mask), mask);
+        return _mm_or_si128(_mm_and_si128(lo_set, _mm_set1_epi8(1)),
+                            _mm_and_si128(hi_set, _mm_set1_epi8(2)));
+    }
+
+    void rows_sse2(const uint8_t* planes, size_t count, uint8_t* pixels, bool x_flip) {
+        __m128i mask = _mm_set1_epi64x(x_flip ? RIGHT_FIRST : LEFT_FIRST);
+        size_t row = 0;
+        for(; row + 8 <= count; row += 8) {
+            __m128i spread[8];
+            spread_8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + 2*row)), spread);
+            for(int pair = 0; pair < 4; ++pair) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + 8*row + 16*pair),
+                                 pixels_sse2(spread[pair], spread[4 + pair], mask));
+            }
+        }
+        rows_scalar(planes + 2*row, count - row, pixels + 8*row, x_flip);
+    }
+
+    __attribute__((target("avx2")))
+    void rows_avx2(const uint8_t* planes, size_t count, uint8_t* pixels, bool x_flip) {
+        const __m256i mask = _mm256_set1_epi64x(x_flip ? RIGHT_FIRST : LEFT_FIRST);
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i two = _mm256_set1_epi8(2);
+        size_t row = 0;
+        for(; row + 16 <= count; row += 16) {
+            //rows 0-7 in the low lane, 8-15 in the high lane; every step
+            //below stays within its lane
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planes + 2*row));
+            __m256i lo = _mm256_packus_epi16(_mm256_and_si256(in, _mm256_set1_epi16(0x00FF)), _mm256_setzero_si256());
+            __m256i hi = _mm256_packus_epi16(_mm256_srli_epi16(in, 8), _mm256_setzero_si256());
+            __m256i lo_2 = _mm256_unpacklo_epi8(lo, lo);
+            __m256i hi_2 = _mm256_unpacklo_epi8(hi, hi);
+            __m256i lo_4[2] = {_mm256_unpacklo_epi16(lo_2, lo_2), _mm256_unpackhi_epi16(lo_2, lo_2)};
+            __m256i hi_4[2] = {_mm256_unpacklo_epi16(hi_2, hi_2), _mm256_unpackhi_epi16(hi_2, hi_2)};
+            __m256i out[4];
+            for(int i = 0; i < 2; ++i) {
+                for(int half = 0; half < 2; ++half) {
+                    __m256i l = half ? _mm256_unpackhi_epi32(lo_4[i], lo_4[i]) : _mm256_unpacklo_epi32(lo_4[i], lo_4[i]);
+                    __m256i h = half ? _mm256_unpackhi_epi32(hi_4[i], hi_4[i]) : _mm256_unpacklo_epi32(hi_4[i], hi_4[i]);
+                    __m256i l_set = _mm256_cmpeq_epi8(_mm256_and_si256(l, mask), mask);
+                    __m256i h_set = _mm256_cmpeq_epi8(_mm256_and_si256(h, mask), mask);
+                    out[2*i + half] = _mm256_or_si256(_mm256_and_si256(l_set, one), _mm256_and_si256(h_set, two));
+                }
+            }
+            //out[k] holds rows 2k, 2k+1 and 8+2k, 8+2k+1; put the lanes in order
+            __m256i* dest = reinterpret_cast<__m256i*>(pixels + 8*row);
+            _mm256_storeu_si256(dest,     _mm256_permute2x128_si256(out[0], out[1], 0x20));
+            _mm256_storeu_si256(dest + 1, _mm256_permute2x128_si256(out[2], out[3], 0x20));
+            _mm256_storeu_si256(dest + 2, _mm256_permute2x128_si256(out[0], out[1], 0x31));
+            _mm256_storeu_si256(dest + 3, _mm256_permute2x128_si256(out[2], out[3], 0x31));
+        }
+        rows_sse2(planes + 2*row, count - row, pixels + 8*row, x_flip);
+    }
+}
+#endif
+
+namespace {
+    using Kernel = void(*)(const uint8_t*, size_t, uint8_t*, bool);
+    struct Choice {
+        Kernel kernel;
+        const char* name;
+    };
+
+    Choice choose() {
+#ifdef GB5_SIMD_X86
+        if(__builtin_cpu_supports("avx2")) {
+            return {rows_avx2, "avx2"};
+        }
+        return {rows_sse2, "sse2"};
+#else
+        return {rows_scalar, "scalar"};
+#endif
+    }
+
+    const Choice& chosen() {
+        static const Choice choice = choose();
+        return choice;
+    }
+}
+
+void rows(const uint8_t* planes, size_t count, uint8_t* pixels, bool x_flip) {
+    chosen().kernel(planes, count, pixels, x_flip);
+}
+
+const char* kernel_name() {
+    return chosen().name;
+}
+
+}   //TileDecode
@@ -23,81 +23,47 @@ namespace Operation {
 
     namespace ALU {
         //primitive arithmetic and logic micro ops
+        //flags are deferred, see CPU::defer_flags
         void add_8(CPU& cpu, uint8_t num) {
-            uint16_t result = cpu.A + num;
-
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 0);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_add_8(cpu.A, num));
-            cpu.set_flag(Flag::CARRY, result > 0xff);
-
-            cpu.A = result & 0xff;
+            cpu.defer_flags(CPU::FlagOp::ADD, cpu.A, num, 0);
+            cpu.A += num;
         }
         void adc_8(CPU& cpu, uint8_t num) {
-            bool c = cpu.get_flag(Flag::CARRY);
-            uint16_t result = cpu.A + num + c;
-
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 0);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_add_8(cpu.A, num, c));
-            cpu.set_flag(Flag::CARRY, result > 0xff);
-
-            cpu.A = result & 0xff;
+            bool c = cpu.carry_flag();
+            cpu.defer_flags(CPU::FlagOp::ADD, cpu.A, num, c);
+            cpu.A += num + c;
         }
         void sub_8(CPU& cpu, uint8_t num) {
-            uint16_t result = cpu.A - num;
-
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 1);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_sub_8(cpu.A, num));
-            cpu.set_flag(Flag::CARRY, num > cpu.A);
-
-            cpu.A = result & 0xff;
+            cpu.defer_flags(CPU::FlagOp::SUB, cpu.A, num, 0);
+            cpu.A -= num;
         }
         void sbc_8(CPU& cpu, uint8_t num) {
-            bool c = cpu.get_flag(Flag::CARRY);
-            uint16_t result = cpu.A - num - c;
-
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 1);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_sub_8(cpu.A, num, c));
-            cpu.set_flag(Flag::CARRY, num + c > cpu.A);
-
-            cpu.A = result & 0xff;
+            bool c = cpu.carry_flag();
+            cpu.defer_flags(CPU::FlagOp::SUB, cpu.A, num, c);
+            cpu.A -= num + c;
         }
         void cp_8(CPU& cpu, uint8_t num) {
-            uint16_t result = cpu.A - num;
-
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 1);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_sub_8(cpu.A, num));
-            cpu.set_flag(Flag::CARRY, num > cpu.A);
+            cpu.defer_flags(CPU::FlagOp::SUB, cpu.A, num, 0);
         }
         void inc_8(CPU& cpu, uint8_t& num) {
-            uint16_t result = num + 1;
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 0);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_add_8(num, 1));
-            num = result & 0xff;
+            cpu.defer_flags(CPU::FlagOp::INC, num, 1, cpu.carry_flag());
+            num++;
         }
         void dec_8(CPU& cpu, uint8_t& num) {
-            uint16_t result = num - 1;
-            cpu.set_flag(Flag::ZERO, (result&0xff) == 0);
-            cpu.set_flag(Flag::NEGATIVE, 1);
-            cpu.set_flag(Flag::HALF_CARRY, Arithmetic::half_carry_sub_8(num, 1));
-            num = result&0xff;
+            cpu.defer_flags(CPU::FlagOp::DEC, num, 1, cpu.carry_flag());
+            num--;
         }
         void and_8(CPU& cpu, uint8_t num) {
             cpu.A = cpu.A & num;
-            cpu.F = flag_state(cpu.A == 0, 0, 1, 0);
+            cpu.set_flags(flag_state(cpu.A == 0, 0, 1, 0));
         }
         void or_8(CPU& cpu, uint8_t num) {
             cpu.A = cpu.A | num;
-            cpu.F = flag_state(cpu.A == 0, 0, 0, 0);
+            cpu.set_flags(flag_state(cpu.A == 0, 0, 0, 0));
         }
         void xor_8(CPU& cpu, uint8_t num) {
             cpu.A = cpu.A ^ num;
-            cpu.F = flag_state(cpu.A == 0, 0, 0, 0);
+            cpu.set_flags(flag_state(cpu.A == 0, 0, 0, 0));
         }
         void decimal_adjust(CPU& cpu) {
             uint8_t correction = 0;
@@ -121,6 +87,18 @@ namespace Operation {
             cpu.set_flag(Flag::HALF_CARRY, false); //h always cleared
             cpu.set_flag(Flag::CARRY, c);          //c updated
         }
+        uint16_t add_sp_e(CPU& cpu, uint8_t offset) {
+            //flags come from the unsigned add of the low byte
+            bool half_carry = ((cpu.sp & 0xF) + (offset & 0xF)) > 0xF;
+            bool carry = ((cpu.sp & 0xFF) + offset) > 0xFF;
+
+            cpu.set_flag(Flag::ZERO, 0);
+            cpu.set_flag(Flag::NEGATIVE, 0);
+            cpu.set_flag(Flag::HALF_CARRY, half_carry);
+            cpu.set_flag(Flag::CARRY, carry);
+
+            return cpu.sp + static_cast<int8_t>(offset);
+        }
     } //ALU
 
 void NOP(CPU& cpu) {}
@@ -236,8 +214,12 @@ void POP_rr(CPU& cpu, uint8_t& hi, uint8_t& lo) {
     cpu.sp++;
 }
 
+void PUSH_AF(CPU& cpu) {
+    cpu.sync_flags();
+    PUSH_rr(cpu, cpu.A, cpu.F);
+}
 void POP_AF(CPU& cpu) {
-    cpu.F = cpu.read_memory(cpu.sp) & 0xF0;
+    cpu.set_flags(cpu.read_memory(cpu.sp) & 0xF0);
     cpu.sp++;
     cpu.A = cpu.read_memory(cpu.sp);
     cpu.sp++;
@@ -246,15 +228,8 @@ void POP_AF(CPU& cpu) {
 void LD_HL_SPe(CPU& cpu) {
     uint8_t offset = cpu.fetch_byte();
     cpu.idle_m_cycle(); //dummy cycle
-    bool half_carry = ((cpu.sp & 0xF) + (offset & 0xF)) > 0xF;
-    bool carry = ((cpu.sp & 0xFF) + offset) > 0xFF;
-    uint16_t result = cpu.sp + static_cast<int8_t>(offset);
+    uint16_t result = ALU::add_sp_e(cpu, offset);
 
-    cpu.set_flag(Flag::ZERO, 0);
-    cpu.set_flag(Flag::NEGATIVE, 0);
-    cpu.set_flag(Flag::HALF_CARRY, half_carry);
-    cpu.set_flag(Flag::CARRY, carry);
-    
     cpu.H = result >> 8;
     cpu.L = result & 0xff;
 }
@@ -369,17 +344,7 @@ void ADD_SPe(CPU& cpu) {
     uint8_t offset = cpu.fetch_byte();
 
     cpu.idle_m_cycle();
-
-    bool half_carry = ((cpu.sp & 0xF) + (offset & 0xF)) > 0xF;
-    bool carry = ((cpu.sp & 0xFF) + offset) > 0xFF;
-    uint16_t result = cpu.sp + static_cast<int8_t>(offset);
-
-    cpu.set_flag(Flag::ZERO, 0);
-    cpu.set_flag(Flag::NEGATIVE, 0);
-    cpu.set_flag(Flag::HALF_CARRY, half_carry);
-    cpu.set_flag(Flag::CARRY, carry);
-
-    cpu.sp = result;
+    cpu.sp = ALU::add_sp_e(cpu, offset);
     cpu.idle_m_cycle();
 }
 
@@ -389,23 +354,24 @@ using RotFunc = uint8_t(*)(uint8_t num, bool& carry); //rot/shift function
 void ROT_Inst_A(CPU& cpu, RotFunc func) {
     bool carry = cpu.get_flag(Flag::CARRY);
     cpu.A = func(cpu.A, carry);
-    cpu.F = flag_state(0, 0, 0, carry);
+    cpu.set_flags(flag_state(0, 0, 0, carry));
 }
 //-------PREFIX ops--------//
 void PREFIX(CPU& cpu) {
-    cpu.prefix_mode();
+    //the prefixed opcode is fetched as part of the same instruction
+    cpu.execute_prefixed();
 }
 void ROT_Inst_r(CPU& cpu, RotFunc func, uint8_t& reg) {   
     bool carry = cpu.get_flag(Flag::CARRY);
     reg = func(reg, carry);
-    cpu.F = flag_state(!reg, 0, 0, carry);
+    cpu.set_flags(flag_state(!reg, 0, 0, carry));
 }
 void ROT_Inst_m(CPU& cpu, RotFunc func) {
     uint8_t arg = cpu.read_memory(pair(cpu.H, cpu.L));
     bool carry = cpu.get_flag(Flag::CARRY);
     uint8_t result = func(arg, carry);
     cpu.write_memory(pair(cpu.H, cpu.L), result);
-    cpu.F = flag_state(!result, 0, 0, carry);
+    cpu.set_flags(flag_state(!result, 0, 0, carry));
 }
 
 void BIT_r(CPU& cpu, uint8_t& reg, uint8_t bit) {
@@ -423,12 +389,12 @@ void BIT_m(CPU& cpu, uint8_t bit) {
 }
 void SWAP_r(CPU& cpu, uint8_t& reg) {
     reg = Arithmetic::swap_nibs(reg);
-    cpu.F = flag_state(reg == 0, 0, 0, 0);
+    cpu.set_flags(flag_state(reg == 0, 0, 0, 0));
 }
 void SWAP_m(CPU& cpu) {
     uint8_t arg = cpu.read_memory(pair(cpu.H, cpu.L));
     arg = Arithmetic::swap_nibs(arg);
-    cpu.F = flag_state(arg == 0, 0, 0, 0);
+    cpu.set_flags(flag_state(arg == 0, 0, 0, 0));
     cpu.write_memory(pair(cpu.H, cpu.L), arg);
 }
 void SET_r(CPU& cpu, uint8_t& reg, uint8_t bit) {   
@@ -456,7 +422,7 @@ void JP(CPU& cpu, ConditionCheck cc) {
     uint8_t addr_lo = cpu.fetch_byte();
     uint8_t addr_hi = cpu.fetch_byte();
 
-    if(!cc(cpu.F)) {
+    if(!cc(cpu.flags())) {
         return;
     }
 
@@ -469,7 +435,7 @@ void JPHL(CPU& cpu){
 void JR(CPU& cpu, ConditionCheck cc) {
     uint8_t byte = cpu.fetch_byte();
 
-    if(!cc(cpu.F)) {
+    if(!cc(cpu.flags())) {
         return;
     }
 
@@ -481,7 +447,7 @@ void CALL(CPU& cpu, ConditionCheck cc){
     uint8_t addr_lo = cpu.fetch_byte();
     uint8_t addr_hi = cpu.fetch_byte();
 
-    if(!cc(cpu.F)) return;
+    if(!cc(cpu.flags())) return;
 
     cpu.sp--;
     cpu.write_memory(cpu.sp, cpu.pc >> 8);
@@ -505,7 +471,7 @@ void RET_IF(CPU& cpu, ConditionCheck cc) {
     //unlike conditional CALL, JP, JR, conditional RET has 
     //a dedicated cycle just for condition check
     cpu.idle_m_cycle();
-    if(!cc(cpu.F)) {
+    if(!cc(cpu.flags())) {
         return;
     }
 
@@ -0,0 +1,89 @@
+#include "Jit/CodeArena.h"
+#include "BlockCache.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+CodeArena::CodeArena()
+    :slots(SLOT_COUNT)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        //nothing is translated yet, so nothing needs to run
+        void* mem = mmap(nullptr, SLOT_SIZE * SLOT_COUNT, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mem != MAP_FAILED) {
+            base = static_cast<uint8_t*>(mem);
+        }
+#endif
+    }
+
+CodeArena::~CodeArena() {
+#if defined(__unix__) || defined(__APPLE__)
+    if(base) {
+        munmap(base, SLOT_SIZE * SLOT_COUNT);
+    }
+#endif
+}
+
+bool CodeArena::open(int slot) {
+#if defined(__unix__) || defined(__APPLE__)
+    return protect(slot, PROT_READ | PROT_WRITE);
+#else
+    return false;
+#endif
+}
+
+bool CodeArena::seal(int slot) {
+#if defined(__unix__) || defined(__APPLE__)
+    return protect(slot, PROT_READ | PROT_EXEC);
+#else
+    return false;
+#endif
+}
+
+bool CodeArena::protect(int slot, int prot) {
+#if defined(__unix__) || defined(__APPLE__)
+    //slots are page multiples on 4k pages; with bigger pages a slot's
+    //neighbours change along with it, which is fine as nothing runs while
+    //a block is translated
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = reinterpret_cast<uintptr_t>(code(slot)) & ~(page - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(code(slot)) + SLOT_SIZE + page - 1) & ~(page - 1);
+    if(mprotect(reinterpret_cast<void*>(start), end - start, prot) == 0) {
+        return true;
+    }
+    //translations already sealed keep running; no new ones are made
+    refused = true;
+#endif
+    return false;
+}
+
+int CodeArena::allocate(Block& owner) {
+    if(owner.slot >= 0 && slots[owner.slot].owner == &owner) {
+        touch(owner.slot);
+        return owner.slot;
+    }
+    int slot;
+    if(used < SLOT_COUNT) {
+        slot = used++;
+    } else {
+        //evict the least recently run translation
+        slot = 0;
+        for(size_t i = 1; i < SLOT_COUNT; ++i) {
+            if(slots[i].last_used < slots[slot].last_used) {
+                slot = i;
+            }
+        }
+        Block* victim = slots[slot].owner;
+        if(victim && victim->slot == slot) {
+            victim->native = nullptr;
+            victim->slot = -1;
+            victim->hits = 0;
+        }
+    }
+    slots[slot].owner = &owner;
+    owner.slot = slot;
+    touch(slot);
+    return slot;
+}
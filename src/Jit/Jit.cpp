@@ -0,0 +1,661 @@
+#include <vector>
+#include "Jit/Jit.h"
+#include "Jit/X64Emitter.h"
+#include "BlockCache.h"
+#include "CPU.h"
+#include "Memory/Bus.h"
+#include "Memory/MMU.h"
+#include "Memory/InterruptController.h"
+#include "Memory/Spaces.h"
+
+Jit::Jit(CPU& cpu, Bus& bus, MMU& mmu, InterruptController& ic)
+    :cpu{cpu}, bus{bus}, mmu{mmu}, interrupt_controller{ic}
+    {}
+
+bool Jit::supported() {
+#ifdef GB5_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Jit::poll(Jit* jit) {
+    //native ops read and write F directly
+    jit->cpu.sync_flags();
+    jit->bus.run_due_events();
+    return jit->bus.get_cycles() >= jit->until || jit->bus.dma_active() ||
+           (jit->cpu.IME && jit->interrupt_controller.active()) || !jit->running->valid;
+}
+
+void Jit::run_events(Jit* jit) {
+    jit->bus.run_due_events();
+}
+
+bool Jit::run(Block& block, uint16_t pc, unsigned long until) {
+    if(!block.native) {
+        //only rom is translated; ram code changes too often to pay off
+        if(pc > Space::ROM_END || ++block.hits < HOT_THRESHOLD || !compile(block, pc)) {
+            return false;
+        }
+    }
+    arena.touch(block.slot);
+    cpu.sync_flags();
+    this->until = until;
+    running = &block;
+    block.native();
+    return true;
+}
+
+#ifdef GB5_JIT_X64
+namespace {
+using Cond = X64Emitter::Cond;
+using Alu = X64Emitter::Alu;
+
+//what the translator does with one decoded op
+enum class Kind {
+    HANDLER, NOP, LD_R_R, LD_R_N, LD_RR_N16, LD_SP_N16, INC_RR, DEC_RR, INC_SP, DEC_SP,
+    INC_R, DEC_R, ALU_R, ALU_N, CPL, SCF, CCF, DI, JR, JP,
+    //memory ops, see Translator::memory
+    LD_R_M, LD_M_R, LD_M_N, LD_HLI, LD_A_NN, LD_NN_A, ALU_M, INC_M, DEC_M,
+    PUSH, POP, CALL, RET, RST
+};
+
+//gb alu rows (add adc sub sbc and xor or cp) as x86 group 1 ops
+constexpr Alu ALU_ROWS[] = {Alu::ADD, Alu::ADC, Alu::SUB, Alu::SBB, Alu::AND, Alu::XOR, Alu::OR, Alu::CMP};
+
+Kind classify(const DecodedOp& op) {
+    uint16_t code = op.opcode;
+    if(code > 0xFF) return Kind::HANDLER;
+    bool reg_operand = op.r1 != nullptr;
+    switch(code) {
+        case 0x00: return Kind::NOP;
+        case 0x01: case 0x11: case 0x21: return Kind::LD_RR_N16;
+        case 0x31: return Kind::LD_SP_N16;
+        case 0x03: case 0x13: case 0x23: return Kind::INC_RR;
+        case 0x0B: case 0x1B: case 0x2B: return Kind::DEC_RR;
+        case 0x33: return Kind::INC_SP;
+        case 0x3B: return Kind::DEC_SP;
+        case 0x2F: return Kind::CPL;
+        case 0x37: return Kind::SCF;
+        case 0x3F: return Kind::CCF;
+        case 0xF3: return Kind::DI;
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: return Kind::JR;
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: return Kind::JP;
+        case 0xC6: case 0xCE: case 0xD6: case 0xDE:
+        case 0xE6: case 0xEE: case 0xF6: case 0xFE: return Kind::ALU_N;
+        case 0x0A: case 0x1A: return Kind::LD_R_M;
+        case 0x02: case 0x12: return Kind::LD_M_R;
+        case 0x36: return Kind::LD_M_N;
+        case 0x22: case 0x2A: case 0x32: case 0x3A: return Kind::LD_HLI;
+        case 0xFA: return Kind::LD_A_NN;
+        case 0xEA: return Kind::LD_NN_A;
+        case 0x34: return Kind::INC_M;
+        case 0x35: return Kind::DEC_M;
+        case 0xC5: case 0xD5: case 0xE5: case 0xF5: return Kind::PUSH;
+        case 0xC1: case 0xD1: case 0xE1: case 0xF1: return Kind::POP;
+        case 0xCD: case 0xC4: case 0xCC: case 0xD4: case 0xDC: return Kind::CALL;
+        case 0xC9: case 0xC0: case 0xC8: case 0xD0: case 0xD8: return Kind::RET;
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF:
+        case 0xE7: case 0xEF: case 0xF7: case 0xFF: return Kind::RST;
+        case 0x76: return Kind::HANDLER;    //halt
+    }
+    if(code < 0x40 && reg_operand) {
+        switch(code & 7) {
+            case 4: return Kind::INC_R;
+            case 5: return Kind::DEC_R;
+            case 6: return Kind::LD_R_N;
+        }
+    }
+    //(hl) forms and halt have no bound register pair
+    if(code >= 0x40 && code <= 0x7F && reg_operand && op.r2 && !op.r3) return Kind::LD_R_R;
+    if(code >= 0x40 && code <= 0x7F) return (code & 7) == 6 ? Kind::LD_R_M : Kind::LD_M_R;
+    if(code >= 0x80 && code <= 0xBF && reg_operand) return Kind::ALU_R;
+    if(code >= 0x80 && code <= 0xBF) return Kind::ALU_M;
+    return Kind::HANDLER;
+}
+
+//addresses whose page always has a handler in front of it
+bool never_plain(uint16_t addr) {
+    return (addr >= Space::VRAM_START && addr <= Space::VRAM_END) || addr >= Space::OAM_START;
+}
+
+uint16_t jr_target(const DecodedOp& op, uint16_t next) {
+    return next + static_cast<int8_t>(op.imm);
+}
+
+//flag bit to test and whether the branch is taken on a set bit
+struct Condition {
+    uint8_t mask;
+    bool when_set;
+};
+Condition condition(uint16_t code) {
+    switch(code) {
+        case 0x20: case 0xC2: case 0xC4: case 0xC0: return {0x80, false};  //NZ
+        case 0x28: case 0xCA: case 0xCC: case 0xC8: return {0x80, true};   //Z
+        case 0x30: case 0xD2: case 0xD4: case 0xD0: return {0x10, false};  //NC
+        case 0x38: case 0xDA: case 0xDC: case 0xD8: return {0x10, true};   //C
+        default:   return {0, true};                    //always
+    }
+}
+
+//worst case bytes for one op plus its poll and handler fallback, and what
+//the block end needs
+constexpr size_t OP_ROOM = 320;
+constexpr size_t END_ROOM = 32;
+
+class Translator {
+private:
+    X64Emitter e;
+    CPU& cpu;
+    Jit* jit;
+    uint8_t* const* read_pages;
+    uint8_t* const* write_pages;
+    const bool* code_pages;
+    std::vector<uint8_t*> exits;    //jumps to the epilogue
+
+    int32_t at(const void* field) const {
+        return static_cast<int32_t>(static_cast<const uint8_t*>(field) - reinterpret_cast<const uint8_t*>(&cpu));
+    }
+    int32_t PC() const {return at(&cpu.pc);}
+    int32_t F() const {return at(&cpu.F);}
+    int32_t A() const {return at(&cpu.A);}
+    int32_t SP() const {return at(&cpu.sp);}
+
+    void call(const void* fn) {
+        e.mov_rax_imm(reinterpret_cast<uint64_t>(fn));
+        e.bytes({0xFF, 0xD0});                          //call rax
+    }
+
+    //builds gb flags from lahf: zf(6) -> z(7), af(4) -> h(5), cf(0) -> c(4)
+    //keep selects which bits of F survive; af is undefined after logic ops
+    void flags_from_host(uint8_t keep, bool half, bool carry, uint8_t set) {
+        e.bytes({0x9F});                                //lahf
+        e.bytes({0x0F, 0xB6, 0xCC});                    //movzx ecx, ah
+        e.bytes({0x83, 0xE1, static_cast<uint8_t>(half ? 0x50 : 0x40)});  //and ecx, mask
+        e.bytes({0x01, 0xC9});                          //add ecx, ecx
+        if(carry) {
+            e.bytes({0x0F, 0xB6, 0xD4});                //movzx edx, ah
+            e.bytes({0x83, 0xE2, 0x01});                //and edx, 1
+            e.bytes({0xC1, 0xE2, 0x04});                //shl edx, 4
+            e.bytes({0x09, 0xD1});                      //or ecx, edx
+        }
+        if(set) {
+            e.bytes({0x83, 0xC9, set});                 //or ecx, set
+        }
+        e.byte_imm(Alu::AND, F(), keep);
+        e.or_byte_cl(F());
+    }
+
+    //fast path falls through when no event is due and until is not reached;
+    //otherwise pc is committed and poll decides whether to leave
+    void check(uint16_t next, bool store_pc) {
+        e.bytes({0x49, 0x8B, 0x04, 0x24});              //mov rax, [r12]
+        e.bytes({0x49, 0x3B, 0x06});                    //cmp rax, [r14]
+        uint8_t* slow = e.jcc(Cond::ABOVE_EQUAL);
+        e.bytes({0x4C, 0x39, 0xE8});                    //cmp rax, r13
+        uint8_t* fast = e.jcc(Cond::BELOW);
+        e.bind(slow);
+        if(store_pc) {
+            e.store_word_imm(PC(), next);
+        }
+        poll();
+        e.bind(fast);
+    }
+    void poll() {
+        e.bytes({0x4C, 0x89, 0xFF});                    //mov rdi, r15
+        call(reinterpret_cast<const void*>(&Jit::poll));
+        e.bytes({0x84, 0xC0});                          //test al, al
+        exits.push_back(e.jcc(Cond::NOT_EQUAL));
+    }
+
+    //a = a <op> operand for the alu rows, flags as the gb sets them
+    enum class Operand {REGISTER, IMMEDIATE, DL};
+    void alu(const DecodedOp& op, Operand operand) {
+        int row = ((operand == Operand::IMMEDIATE ? op.opcode - 0xC6 : op.opcode - 0x80) / 8) & 7;
+        Alu alu = ALU_ROWS[row];
+        e.load_byte(A());
+        if(alu == Alu::ADC || alu == Alu::SBB) {
+            //gb carry (bit 4) into the host carry
+            e.load_byte_ecx(F());
+            e.bytes({0xC1, 0xE9, 0x05});                //shr ecx, 5
+        }
+        switch(operand) {
+            case Operand::IMMEDIATE: e.alu_imm(alu, op.imm); break;
+            case Operand::REGISTER:  e.alu_byte(alu, at(op.r1)); break;
+            case Operand::DL:        e.bytes({static_cast<uint8_t>(alu * 8), 0xD0}); break;    //<alu> al, dl
+        }
+        bool logic = alu == Alu::AND || alu == Alu::OR || alu == Alu::XOR;
+        bool subtract = alu == Alu::SUB || alu == Alu::SBB || alu == Alu::CMP;
+        //logic ops assign F outright, arithmetic keeps the unused low nibble
+        uint8_t set = (alu == Alu::AND ? 0x20 : 0) | (subtract ? 0x40 : 0);
+        flags_from_host(logic ? 0x00 : 0x0F, !logic, !logic, set);
+        if(alu != Alu::CMP) {
+            e.store_byte(A());
+        }
+    }
+
+    //hi:lo + 1 or - 1 back into the pair
+    void step_pair(const uint8_t* hi, const uint8_t* lo, bool up) {
+        pair_address(hi, lo);
+        if(up) {
+            e.bytes({0xFF, 0xC0});                      //inc eax
+        } else {
+            e.bytes({0xFF, 0xC8});                      //dec eax
+        }
+        e.store_byte(at(lo));
+        e.store_byte_ah(at(hi));
+    }
+
+    void branch(const DecodedOp& op, uint16_t next, uint16_t target, uint8_t cycles) {
+        Condition c = condition(op.opcode);
+        e.store_word_imm(PC(), next);
+        e.add_cycles(cycles);
+        uint8_t* skip = nullptr;
+        if(c.mask) {
+            e.test_byte_imm(F(), c.mask);
+            skip = e.jcc(c.when_set ? Cond::EQUAL : Cond::NOT_EQUAL);
+        }
+        e.store_word_imm(PC(), target);
+        e.add_cycles(1);
+        if(skip) {
+            e.bind(skip);
+        }
+    }
+
+    //returns false for ops left to their handler
+    bool native(const DecodedOp& op, uint16_t next) {
+        switch(classify(op)) {
+            case Kind::NOP:
+                e.add_cycles(1);
+                break;
+            case Kind::LD_R_R:
+                e.load_byte(at(op.r2));
+                e.store_byte(at(op.r1));
+                e.add_cycles(1);
+                break;
+            case Kind::LD_R_N:
+                e.store_byte_imm(at(op.r1), op.imm);
+                e.add_cycles(2);
+                break;
+            case Kind::LD_RR_N16:
+                e.store_byte_imm(at(op.r1), op.imm >> 8);
+                e.store_byte_imm(at(op.r2), op.imm & 0xFF);
+                e.add_cycles(3);
+                break;
+            case Kind::LD_SP_N16:
+                e.store_word_imm(at(&cpu.sp), op.imm);
+                e.add_cycles(3);
+                break;
+            case Kind::INC_RR:
+            case Kind::DEC_RR:
+                step_pair(op.r1, op.r2, classify(op) == Kind::INC_RR);
+                e.add_cycles(2);
+                break;
+            case Kind::INC_SP:
+                e.inc_word(at(&cpu.sp));
+                e.add_cycles(2);
+                break;
+            case Kind::DEC_SP:
+                e.dec_word(at(&cpu.sp));
+                e.add_cycles(2);
+                break;
+            case Kind::INC_R:
+                e.inc_byte(at(op.r1));
+                flags_from_host(0x1F, true, false, 0);
+                e.add_cycles(1);
+                break;
+            case Kind::DEC_R:
+                e.dec_byte(at(op.r1));
+                flags_from_host(0x1F, true, false, 0x40);
+                e.add_cycles(1);
+                break;
+            case Kind::ALU_R:
+            case Kind::ALU_N: {
+                bool immediate = classify(op) == Kind::ALU_N;
+                alu(op, immediate ? Operand::IMMEDIATE : Operand::REGISTER);
+                e.add_cycles(immediate ? 2 : 1);
+                break;
+            }
+            case Kind::CPL:
+                e.not_byte(A());
+                e.byte_imm(Alu::OR, F(), 0x60);
+                e.add_cycles(1);
+                break;
+            case Kind::SCF:
+                e.byte_imm(Alu::AND, F(), 0x9F);
+                e.byte_imm(Alu::OR, F(), 0x10);
+                e.add_cycles(1);
+                break;
+            case Kind::CCF:
+                e.byte_imm(Alu::XOR, F(), 0x10);
+                e.byte_imm(Alu::AND, F(), 0x9F);
+                e.add_cycles(1);
+                break;
+            case Kind::DI:
+                e.store_byte_imm(at(&cpu.IME), 0);
+                e.add_cycles(1);
+                break;
+            case Kind::JR:
+                branch(op, next, jr_target(op, next), 2);
+                break;
+            case Kind::JP:
+                branch(op, next, op.imm, 3);
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+
+    //memory ops touch host memory through the mmu's page tables, which is
+    //what Bus::read and Bus::write come down to for plain memory while no
+    //dma runs (native code never runs during one). everything else jumps
+    //to the op's handler before any of the op has happened
+    std::vector<uint8_t*> slow;     //guard jumps of the op being translated
+
+    //eax = hi:lo
+    void pair_address(const uint8_t* hi, const uint8_t* lo) {
+        e.load_byte(at(hi));
+        e.bytes({0xC1, 0xE0, 0x08});                    //shl eax, 8
+        e.alu_byte(Alu::OR, at(lo));
+    }
+    //eax = sp + delta, wrapped to 16 bits
+    void stack_address(int8_t delta) {
+        e.load_word(SP());
+        if(delta) {
+            e.bytes({0x83, 0xC0, static_cast<uint8_t>(delta)});    //add eax, delta
+            e.bytes({0x0F, 0xB7, 0xC0});                //movzx eax, ax
+        }
+        //both bytes of a 16-bit access have to be on the same page
+        e.bytes({0x3C, 0xFF});                          //cmp al, 0xff
+        slow.push_back(e.jcc(Cond::EQUAL));
+    }
+    //address in eax -> host page in rdx and offset in ecx, as long as the
+    //page is plain memory for the accesses asked for
+    void direct(bool read, bool write) {
+        e.bytes({0x89, 0xC1});                          //mov ecx, eax
+        e.bytes({0xC1, 0xE9, 0x08});                    //shr ecx, 8
+        if(write) {
+            //blocks decoded from the page have to hear about the write
+            e.mov_rdx_imm(reinterpret_cast<uint64_t>(code_pages));
+            e.bytes({0x80, 0x3C, 0x0A, 0x00});          //cmp byte [rdx + rcx], 0
+            slow.push_back(e.jcc(Cond::NOT_EQUAL));
+        }
+        e.mov_rdx_imm(reinterpret_cast<uint64_t>(write ? write_pages : read_pages));
+        e.bytes({0x48, 0x8B, 0x14, 0xCA});              //mov rdx, [rdx + rcx*8]
+        e.bytes({0x48, 0x85, 0xD2});                    //test rdx, rdx
+        slow.push_back(e.jcc(Cond::EQUAL));
+        if(read && write) {
+            e.mov_rsi_imm(reinterpret_cast<uint64_t>(read_pages));
+            e.bytes({0x48, 0x3B, 0x14, 0xCE});          //cmp rdx, [rsi + rcx*8]
+            slow.push_back(e.jcc(Cond::NOT_EQUAL));
+        }
+        e.bytes({0x0F, 0xB6, 0xC8});                    //movzx ecx, al
+    }
+    void read_byte()  {e.bytes({0x0F, 0xB6, 0x04, 0x0A});}     //movzx eax, byte [rdx + rcx]
+    void write_byte() {e.bytes({0x88, 0x04, 0x0A});}           //mov [rdx + rcx], al
+    void read_word()  {e.bytes({0x0F, 0xB7, 0x04, 0x0A});}     //movzx eax, word [rdx + rcx]
+    void write_word() {e.bytes({0x66, 0x89, 0x04, 0x0A});}     //mov [rdx + rcx], ax
+    //push a constant return address and jump
+    void call_to(uint16_t ret, uint16_t target) {
+        stack_address(-2);
+        direct(false, true);
+        e.bytes({0x66, 0xC7, 0x04, 0x0A}); e.imm16(ret);      //mov word [rdx + rcx], ret
+        e.word_imm(Alu::SUB, SP(), 2);
+        e.store_word_imm(PC(), target);
+    }
+    //a conditional op's flag test; returns the jump taken when it fails
+    uint8_t* unless(uint16_t code) {
+        Condition c = condition(code);
+        if(!c.mask) {
+            return nullptr;
+        }
+        e.test_byte_imm(F(), c.mask);
+        return e.jcc(c.when_set ? Cond::EQUAL : Cond::NOT_EQUAL);
+    }
+    //the not taken side of a conditional call or return
+    void not_taken(uint8_t* skip, uint16_t next, uint8_t cycles) {
+        if(!skip) {
+            return;
+        }
+        uint8_t* join = e.jmp();
+        e.bind(skip);
+        e.store_word_imm(PC(), next);
+        e.add_cycles(cycles);
+        e.bind(join);
+    }
+
+    //returns whether the op leaves pc set
+    bool memory(const DecodedOp& op, uint16_t next) {
+        Kind kind = classify(op);
+        if((kind == Kind::LD_A_NN || kind == Kind::LD_NN_A) && never_plain(op.imm)) {
+            handler(op, next);
+            return true;
+        }
+        slow.clear();
+        bool sets_pc = false;
+        switch(kind) {
+            case Kind::LD_R_M:
+                pair_address(op.r2, op.r3);
+                direct(true, false);
+                read_byte();
+                e.store_byte(at(op.r1));
+                e.add_cycles(2);
+                break;
+            case Kind::LD_M_R:
+                pair_address(op.r1, op.r2);
+                direct(false, true);
+                e.load_byte(at(op.r3));
+                write_byte();
+                e.add_cycles(2);
+                break;
+            case Kind::LD_M_N:
+                pair_address(&cpu.H, &cpu.L);
+                direct(false, true);
+                e.bytes({0xC6, 0x04, 0x0A}); e.imm8(op.imm);   //mov byte [rdx + rcx], n
+                e.add_cycles(3);
+                break;
+            case Kind::LD_HLI: {
+                bool load = op.opcode & 0x08;
+                pair_address(&cpu.H, &cpu.L);
+                direct(load, !load);
+                if(load) {
+                    read_byte();
+                    e.store_byte(A());
+                } else {
+                    e.load_byte(A());
+                    write_byte();
+                }
+                step_pair(&cpu.H, &cpu.L, op.opcode < 0x30);
+                e.add_cycles(2);
+                break;
+            }
+            case Kind::LD_A_NN:
+                e.mov_eax_imm(op.imm);
+                direct(true, false);
+                read_byte();
+                e.store_byte(A());
+                e.add_cycles(4);
+                break;
+            case Kind::LD_NN_A:
+                e.mov_eax_imm(op.imm);
+                direct(false, true);
+                e.load_byte(A());
+                write_byte();
+                e.add_cycles(4);
+                break;
+            case Kind::ALU_M:
+                pair_address(&cpu.H, &cpu.L);
+                direct(true, false);
+                e.bytes({0x0F, 0xB6, 0x14, 0x0A});      //movzx edx, byte [rdx + rcx]
+                alu(op, Operand::DL);
+                e.add_cycles(2);
+                break;
+            case Kind::INC_M:
+            case Kind::DEC_M:
+                pair_address(&cpu.H, &cpu.L);
+                direct(true, true);
+                read_byte();
+                if(kind == Kind::INC_M) {
+                    e.bytes({0xFE, 0xC0});              //inc al
+                } else {
+                    e.bytes({0xFE, 0xC8});              //dec al
+                }
+                write_byte();                           //leaves the host flags alone
+                flags_from_host(0x1F, true, false, kind == Kind::DEC_M ? 0x40 : 0);
+                e.add_cycles(3);
+                break;
+            case Kind::PUSH: {
+                bool af = op.opcode == 0xF5;
+                stack_address(-2);
+                direct(false, true);
+                pair_address(af ? &cpu.A : op.r1, af ? &cpu.F : op.r2);
+                write_word();
+                e.word_imm(Alu::SUB, SP(), 2);
+                e.add_cycles(4);
+                break;
+            }
+            case Kind::POP: {
+                bool af = op.opcode == 0xF1;
+                stack_address(0);
+                direct(true, false);
+                read_word();
+                if(af) {
+                    e.bytes({0x24, 0xF0});              //and al, 0xf0
+                }
+                e.store_byte(at(af ? &cpu.F : op.r2));
+                e.store_byte_ah(at(af ? &cpu.A : op.r1));
+                e.word_imm(Alu::ADD, SP(), 2);
+                e.add_cycles(3);
+                break;
+            }
+            case Kind::CALL: {
+                uint8_t* skip = unless(op.opcode);
+                call_to(next, op.imm);
+                e.add_cycles(6);
+                not_taken(skip, next, 3);
+                sets_pc = true;
+                break;
+            }
+            case Kind::RET: {
+                uint8_t* skip = unless(op.opcode);
+                stack_address(0);
+                direct(true, false);
+                read_word();
+                e.store_word(PC());
+                e.word_imm(Alu::ADD, SP(), 2);
+                e.add_cycles(skip ? 5 : 4);
+                not_taken(skip, next, 2);
+                sets_pc = true;
+                break;
+            }
+            case Kind::RST:
+                call_to(next, op.arg);
+                e.add_cycles(4);
+                sets_pc = true;
+                break;
+            default:
+                break;
+        }
+        check(next, !sets_pc);
+        uint8_t* done = e.jmp();
+        for(uint8_t* guard : slow) {
+            e.bind(guard);
+        }
+        handler(op, next);
+        e.bind(done);
+        return sets_pc;
+    }
+
+    void handler(const DecodedOp& op, uint16_t next) {
+        e.store_word_imm(PC(), next);
+        //opcode fetch cycle, run any event it makes due like Bus::cycle
+        e.bytes({0x49, 0xFF, 0x04, 0x24});              //inc qword [r12]
+        e.bytes({0x49, 0x8B, 0x04, 0x24});              //mov rax, [r12]
+        e.bytes({0x49, 0x3B, 0x06});                    //cmp rax, [r14]
+        uint8_t* quiet = e.jcc(Cond::BELOW);
+        e.bytes({0x4C, 0x89, 0xFF});                    //mov rdi, r15
+        call(reinterpret_cast<const void*>(&Jit::run_events));
+        e.bind(quiet);
+        e.bytes({0x48, 0x89, 0xDF});                    //mov rdi, rbx
+        e.mov_rsi_imm(reinterpret_cast<uint64_t>(&op));
+        call(reinterpret_cast<const void*>(op.execute));
+        poll();
+    }
+public:
+    Translator(uint8_t* code, size_t size, CPU& cpu, Jit* jit, const MMU& mmu)
+        :e{code, size}, cpu{cpu}, jit{jit}, read_pages{mmu.read_page_table()},
+         write_pages{mmu.write_page_table()}, code_pages{cpu.code_pages()}
+        {}
+
+    void translate(const Block& block, uint16_t pc, Bus& bus, const unsigned long* until) {
+        //prologue: five pushes leave the stack 16-byte aligned for calls
+        e.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+        e.bytes({0x48, 0xBB}); e.imm64(reinterpret_cast<uint64_t>(&cpu));
+        e.bytes({0x49, 0xBC}); e.imm64(reinterpret_cast<uint64_t>(bus.cycle_counter()));
+        e.bytes({0x49, 0xBE}); e.imm64(reinterpret_cast<uint64_t>(bus.next_event_address()));
+        e.bytes({0x49, 0xBF}); e.imm64(reinterpret_cast<uint64_t>(jit));
+        e.mov_rax_imm(reinterpret_cast<uint64_t>(until));
+        e.bytes({0x4C, 0x8B, 0x28});                    //mov r13, [rax]
+        const uint8_t* body = e.here();
+
+        uint16_t addr = pc;
+        bool pc_current = false;    //cpu.pc already holds the right value on fall through
+        for(const DecodedOp& op : block.ops) {
+            if(e.room() < OP_ROOM + END_ROOM) {
+                break;
+            }
+            uint16_t next = addr + op.length;
+            Kind kind = classify(op);
+            if(kind >= Kind::LD_R_M) {
+                pc_current = memory(op, next);
+            } else if(native(op, next)) {
+                bool jump = kind == Kind::JR || kind == Kind::JP;
+                check(next, !jump);
+                pc_current = jump;
+                if(jump && !block.idle.candidate && (kind == Kind::JR ? jr_target(op, next) : op.imm) == pc) {
+                    //tight loop back to the block start stays in native code;
+                    //idle loops go back to CPU::run to be skipped
+                    e.cmp_word_imm(PC(), pc);
+                    e.jcc_to(Cond::EQUAL, body);
+                }
+            } else {
+                handler(op, next);
+                pc_current = true;
+            }
+            addr = next;
+        }
+        if(!pc_current) {
+            e.store_word_imm(PC(), addr);
+        }
+        for(uint8_t* exit : exits) {
+            e.bind(exit);
+        }
+        //epilogue
+        e.bytes({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+    }
+};
+}
+#endif
+
+bool Jit::compile(Block& block, uint16_t pc) {
+#ifdef GB5_JIT_X64
+    if(!arena.available()) {
+        return false;
+    }
+    int slot = arena.allocate(block);
+    if(!arena.open(slot)) {
+        return false;
+    }
+    Translator translator{arena.code(slot), CodeArena::SLOT_SIZE, cpu, this, mmu};
+    translator.translate(block, pc, bus, &until);
+    if(!arena.seal(slot)) {
+        return false;
+    }
+    block.native = reinterpret_cast<void(*)()>(arena.code(slot));
+    return true;
+#else
+    return false;
+#endif
+}
@@ -28,4 +28,14 @@ void MBC1::write(uint16_t addr, uint8_t val) {
     } else {
         return;
     }
+}
+
+void MBC1::save_state(Snapshot& state) const {
+    state = {rom_select_lo, rom_select_hi, static_cast<uint8_t>(select_mode)};
+}
+
+void MBC1::load_state(const Snapshot& state) {
+    rom_select_lo = state[0];
+    rom_select_hi = state[1];
+    select_mode = static_cast<SelectMode>(state[2]);
 }
\ No newline at end of file
@@ -3,24 +3,78 @@
 #include "Graphics/PPU.h"  
 #include "Graphics/OAM.h"
 #include "Memory/MMU.h"
+#include "Memory/InterruptController.h"
 #include "Control/Joypad.h"
 #include "Timer.h"
 #include "Memory/Spaces.h"  
+#include "Profiler.h"
+#include <cstring>
 
-void Bus::cycle() { 
-    if(dmac.active()) {
-        uint16_t src_addr = dmac.start_address() + dmac.offset();
-        uint16_t dest_addr = Space::OAM_START + dmac.offset();
-        uint8_t val = mmu->read(src_addr);
-        oam_dma_dest->write(dest_addr, val);
+//addresses whose contents depend on lazily clocked components
+inline bool observes_ppu(uint16_t addr) {
+    return (addr >= Space::VRAM_START && addr <= Space::VRAM_END) ||
+           (addr >= Space::OAM_START && addr <= Space::OAM_END) ||
+           (addr >= Space::LCDC && addr <= Space::WX) ||
+           (addr == InterruptController::IF);
+}
+inline bool observes_timer(uint16_t addr) {
+    return (addr >= Timer::START && addr <= Timer::END) ||
+           (addr == InterruptController::IF);
+}
+
+void Bus::run_events() {
+    while(scheduler.next() <= cycles) {
+        switch(scheduler.pop()) {
+            case Event::PPU:   ppu->sync(); break;
+            case Event::TIMER: tim->sync(); break;
+            default: break;
+        }
+    }
+}
+
+void Bus::dma_step() {
+    PROFILE_ZONE(DMA);
+    if(dmac.bulk()) {
         dmac.tick();
+        return;
     }
-    if(!ppu || !tim || !jp) return; 
-    for(int i = 0; i < 4; ++i) {
-        ppu->tick();
-        tim->tick();
+    uint16_t src_addr = dmac.start_address() + dmac.offset();
+    uint16_t dest_addr = Space::OAM_START + dmac.offset();
+    //the ppu reads oam while scanning, so it must see the transfer as it happens
+    ppu->sync();
+    catch_up(src_addr);
+    uint8_t val = mmu->read(src_addr);
+    oam_dma_dest->write(dest_addr, val);
+    dmac.tick();
+}
+
+void Bus::catch_up(uint16_t addr) {
+    if(addr < Space::VRAM_START || (addr > Space::VRAM_END && addr < Space::OAM_START)) {
+        //rom, external ram, wram
+        return;
     }
-    cycles++;
+    if(observes_ppu(addr)) ppu->sync();
+    if(observes_timer(addr)) tim->sync();
+}
+
+void Bus::sync() {
+    ppu->sync();
+    tim->sync();
+}
+
+unsigned long Bus::stable_until(uint16_t addr) {
+    if(addr == Space::LY || addr == Space::STAT) {
+        ppu->sync();
+        long quiet = ppu->quiet_dots();
+        return (quiet < 0) ? Scheduler::NEVER : cycles + quiet / 4 + 1;
+    }
+    //memory only the cpu writes, interrupt flags only events raise, and the
+    //joypad, which only changes between frames
+    bool constant = addr <= Space::ROM_END ||
+                    (addr >= Space::WRAM_START && addr <= Space::ECHO_RAM_END) ||
+                    addr_in_hram(addr) || addr == InterruptController::IF ||
+                    addr == InterruptController::IE || addr == JoyPad::ADDRESS;
+    return constant ? Scheduler::NEVER : cycles;
 }
 
 uint8_t Bus::read(uint16_t addr) {
@@ -28,6 +82,7 @@ uint8_t Bus::read(uint16_t addr) {
     cycle(); 
     if(!dmac.active() || addr_in_hram(addr)) {
         //dma blocks the bus
+        catch_up(addr);
         return mmu->read(addr);
     } else {
         return 0xFF;    //garbage read
@@ -37,18 +92,52 @@ uint8_t Bus::read(uint16_t addr) {
 void Bus::write(uint16_t addr, uint8_t val) {
     //writing to bus advances time
     cycle();
+    catch_up(addr);
     if(addr == Space::DMA) {
         start_dma(val);
         mmu->write(addr, val);
         return;
     }
     if(!dmac.active() || addr_in_hram(addr)) {
+        if(addr >= Space::LCDC && addr <= Space::WX) {
+            ppu->timing_register_writing(addr, val);
+        }
         mmu->write(addr, val);
+        //drop cached code decoded from this page
+        cpu->code_written(addr);
+        //register writes can change interrupt timing
+        if(addr >= Space::LCDC && addr <= Space::WX) {
+            //the stat line is re-evaluated on the next dot
+            schedule(Event::PPU, cycles + 1);
+        }
+        if(addr >= Timer::START && addr <= Timer::END) {
+            tim->reschedule();
+        }
     }
 }
 
 void Bus::start_dma(uint8_t page) {
+    PROFILE_ZONE(DMA);
     uint16_t start_addr = (uint16_t)page << 8; 
-    //start DMA
-    dmac.start(start_addr);
-}
\ No newline at end of file
+    uint8_t* table = oam_dma_dest->table();
+    ppu->sync();
+    ppu->oam_dma_starting();
+    if(dmac.active() && dmac.bulk()) {
+        //restarted mid-transfer: bytes that had not landed yet go back
+        std::copy(dmac.displaced.begin() + dmac.offset(), dmac.displaced.end(), table + dmac.offset());
+    }
+    //the cpu can only write hram while dma runs, so plain memory cannot
+    //change under the transfer. if the ppu also leaves oam alone for the
+    //whole window, nobody can tell the bytes landed early
+    const uint8_t* src = mmu->direct_page(start_addr);
+    bool bulk = false;
+    if(src) {
+        long quiet = ppu->oam_quiet_dots();
+        bulk = (quiet < 0) || (quiet >= static_cast<long>(DMA_CYCLES) * 4);
+    }
+    if(bulk) {
+        std::copy(table, table + DMA_CYCLES, dmac.displaced.begin());
+        std::memcpy(table, src, DMA_CYCLES);
+    }
+    dmac.start(start_addr, bulk);
+}
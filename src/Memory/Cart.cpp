@@ -1,10 +1,14 @@
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
 #include "Memory/Cart.h"
 #include "Memory/MMU.h"
 #include "Memory/Spaces.h"
 #include "MBC/MBC1.h"
 
+constexpr size_t HEADER_END = 0x150;
+
 
 Cart::Cart(MMU& memory)
 	:mmu{memory}, rom_container(0x8000)	//rom 32kB by default
@@ -24,9 +28,17 @@ void Cart::load(const std::string& filename){
 
 	//read file into buffer
 	std::ifstream ifs(filename, std::ios::binary);
+	if(!ifs) {
+		throw std::runtime_error("Could not open ROM: " + filename);
+	}
 	std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(ifs), {});
 	std::cout << buffer.size() << '\n';
 
+	//pad truncated images so the header is always readable
+	if(buffer.size() < HEADER_END) {
+		buffer.resize(HEADER_END, 0);
+	}
+
 	init_hardware(static_cast<CartType>(buffer[0x147]));
 	if(mbc) {
 		mmu.connect_MBC(mbc.get());
@@ -40,6 +52,7 @@ void Cart::load(const std::string& filename){
 	rom_bank2 = rom_bank1 + 0x4000;
 	mmu.map_region(Space::ROM_BANK1_START, Space::ROM_BANK1_END, rom_bank1);
 	mmu.map_region(Space::ROM_BANK2_START, Space::ROM_BANK2_END, rom_bank2);
+	mmu.set_rom_bank(1);
 
 	if(ram_exists) {
 		num_ram_banks = ram_sizes[buffer[0x149]];
@@ -50,7 +63,8 @@ void Cart::load(const std::string& filename){
 		}
 	}
 
-	std::copy(buffer.begin(), buffer.end(), rom_container.begin());
+	size_t image_size = std::min(buffer.size(), rom_container.size());
+	std::copy_n(buffer.begin(), image_size, rom_container.begin());
 }
 
 void Cart::enable_ext_ram() {
@@ -71,6 +85,27 @@ void Cart::disable_ext_ram() {
 	}
 }
 
+void Cart::save_state(Snapshot& state) const {
+	state.ram_enable = ram_enable;
+	state.rom_bank2 = rom_bank2;
+	state.ram_bank = ram_bank;
+	//assign keeps the capacity, so saving again does not allocate
+	state.ram.assign(ram_container.begin(), ram_container.end());
+	if(mbc) {
+		mbc->save_state(state.mbc);
+	}
+}
+
+void Cart::load_state(const Snapshot& state) {
+	ram_enable = state.ram_enable;
+	rom_bank2 = state.rom_bank2;
+	ram_bank = state.ram_bank;
+	std::copy(state.ram.begin(), state.ram.end(), ram_container.begin());
+	if(mbc) {
+		mbc->load_state(state.mbc);
+	}
+}
+
 void Cart::init_hardware(CartType type) {
 	//cases intentionally fall through
 	switch(type) {
@@ -3,17 +3,13 @@
 #include "Arithmetic.h"
 
 InterruptController::InterruptController(MMU& mmu)
+    :irq{mmu.io_register(IF)},
+     ie{mmu.io_register(IE)}
     {
-        mmu.map_io_register(IF, &irq);
-        mmu.map_io_register(IE, &ie);
         irq.set(0xE1);
         ie.set(0x00);
     }
 
-bool InterruptController::active() {
-    return (irq.get() & ie.get() & 0x1F);
-}
-
 void InterruptController::clear(Interrupt kind) {
     irq.set( Arithmetic::bit_clear(irq.get(), static_cast<uint8_t>(kind)) );
 }
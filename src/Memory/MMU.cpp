@@ -2,25 +2,38 @@
 #include "Memory/Bus.h"
 #include "Memory/IO.h"
 #include "MBC/MBC.h"
+#include "Graphics/VRAM.h"
+#include "Profiler.h"
 #include <stdexcept>
 #include <iostream>
 
-inline bool between(uint16_t num, uint16_t lo, uint16_t hi) {
-    return (num >= lo) && (num <= hi);
-}
-bool reserved_address(uint16_t addr) {
-    return between(addr, Space::OAM_RESERVED_START, Space::OAM_RESERVED_END);
-}
-
 MMU::MMU(Bus& bus)  
     {
         bus.connect(*this);
         std::fill(std::begin(pages), std::end(pages), nullptr);
-        std::fill(std::begin(io_registers), std::end(io_registers), nullptr);
+        io_hooks.fill(nullptr);
+        read_handlers.fill(Handler::UNMAPPED);
+        write_handlers.fill(Handler::UNMAPPED);
+        std::fill(write_handlers.begin(), write_handlers.begin() + (Space::ROM_END + 1) / 0x100, Handler::MBC);
+        std::fill(read_handlers.begin() + (Space::VRAM_START >> 8), read_handlers.begin() + (Space::VRAM_END >> 8) + 1, Handler::VRAM);
+        std::fill(write_handlers.begin() + (Space::VRAM_START >> 8), write_handlers.begin() + (Space::VRAM_END >> 8) + 1, Handler::VRAM);
+        read_handlers[Space::OAM_START >> 8] = Handler::OAM;
+        write_handlers[Space::OAM_START >> 8] = Handler::OAM;
+        read_handlers[0xFF] = Handler::HIGH;
+        write_handlers[0xFF] = Handler::HIGH;
+        for(int page = 0; page < 0x100; ++page) {
+            update_page(page);
+        }
     }
 
 MMU::~MMU() = default;
 
+void MMU::update_page(uint8_t page) {
+    //pages with a handler never get a direct read or write pointer
+    read_pages[page]  = (read_handlers[page] == Handler::UNMAPPED) ? pages[page] : nullptr;
+    write_pages[page] = (write_handlers[page] == Handler::UNMAPPED) ? pages[page] : nullptr;
+}
+
 void MMU::map_region(uint16_t start, uint16_t end, uint8_t* data) {
     //map pages as byte arrays
     uint8_t start_page = start >> 8;
@@ -28,6 +41,7 @@ void MMU::map_region(uint16_t start, uint16_t end, uint8_t* data) {
     for(auto i = start_page; i <= end_page; ++i) {
         uint16_t offset = (i - start_page) * 0x100; //address of current memory page
         pages[i] = data + offset;
+        update_page(i);
     }
 }
 
@@ -36,73 +50,93 @@ void MMU::unmap_region(uint16_t start, uint16_t end) {
     uint8_t end_page   = end >> 8;
     for(auto i = start_page; i <= end_page; ++i) {
         pages[i] = nullptr;
+        update_page(i);
     }
 }
 
-void MMU::map_io_register(uint16_t addr, IO* reg) {
-    io_registers[addr & 0xFF] = reg;
+void MMU::save_state(Snapshot& state) const {
+    state.pages = pages;
+    state.high = high;
+    state.locks = locks;
+    state.rom_bank = current_rom_bank;
 }
 
-void MMU::map_io_region(uint16_t start, uint16_t end, IO* io_reg) {
-    for(auto i = start; i <= end; ++i) {
-        io_registers[i & 0xFF] = io_reg;
-    }
-}
-
-uint8_t MMU::read(uint16_t addr) {
-    if(reserved_address(addr)) {
-        return 0xFF;
-    }
-    //normal memory
-    if(addr < 0xFF00) {
-        uint8_t* data = pages[addr >> 8];
-        if(data) {
-            return data[addr & 0xFF];
-        } else {
-            //inaccessible memory; ignore read
-            return 0xFF;    
+void MMU::load_state(const Snapshot& state) {
+    if(state.pages != pages) {
+        //cart banks or external ram were switched since
+        pages = state.pages;
+        for(int page = 0; page < 0x100; ++page) {
+            update_page(page);
         }
     }
-    
-    if (addr >= Space::HRAM_START && addr <= Space::HRAM_END) {
-            return hram[addr & 0x7F];
-    }
+    high = state.high;
+    locks = state.locks;
+    current_rom_bank = state.rom_bank;
+}
 
-    IO* io_handler = io_registers[addr & 0xFF];
-    if(io_handler) {
-        return io_handler->read(addr);
-    } else {
-        //return 0xFF;    //unimplemented memory
-        return fallback[addr];
-    }
+void MMU::hook_io_read(uint16_t addr, IO* device) {
+    io_hooks[addr & 0xFF] = device;
+    read_hooks.set(addr & 0xFF);
 }
 
-void MMU::write(uint16_t addr, uint8_t val) {
-    if(reserved_address(addr)) {
-        return;
-    }
+void MMU::hook_io_write(uint16_t addr, IO* device) {
+    io_hooks[addr & 0xFF] = device;
+    write_hooks.set(addr & 0xFF);
+}
 
-    if(addr < 0x8000) {
-        if(mbc) mbc->write(addr, val);
-        return;
+uint8_t MMU::read_slow(uint16_t addr) {
+    uint8_t page = addr >> 8;
+    switch(read_handlers[page]) {
+        case Handler::VRAM:
+            if(pages[page] && !(locks & VRAM_LOCK)) {
+                return pages[page][addr & 0xFF];
+            }
+            return 0xFF;
+        case Handler::OAM:
+            //the unusable tail is padded with 0xFF
+            if(pages[page] && !(locks & OAM_LOCK)) {
+                return pages[page][addr & 0xFF];
+            }
+            return 0xFF;
+        case Handler::HIGH:
+            break;
+        default:
+            //inaccessible memory; ignore read
+            return 0xFF;
     }
-    if(addr < 0xFF00) {
-        uint8_t* data = pages[addr >> 8];
-        if(data) {
-            data[addr & 0xFF] = val;
-        }
-        return; 
+    uint8_t reg = addr & 0xFF;
+    if(read_hooks[reg]) {
+        return io_hooks[reg]->read(addr);
     }
+    return high[reg];
+}
 
-    if(addr >= Space::HRAM_START && addr <= Space::HRAM_END) {
-        hram[addr & 0x7F] = val;
-        return;
+void MMU::write_slow(uint16_t addr, uint8_t val) {
+    uint8_t page = addr >> 8;
+    switch(write_handlers[page]) {
+        case Handler::UNMAPPED:
+            return;
+        case Handler::MBC:
+            if(mbc) mbc->write(addr, val);
+            return;
+        case Handler::VRAM:
+            if(vram && !(locks & VRAM_LOCK)) {
+                vram->write(addr, val);
+            }
+            return;
+        case Handler::OAM:
+            //fea0-feff is not usable
+            if(pages[page] && !(locks & OAM_LOCK) && addr <= Space::OAM_END) {
+                pages[page][addr & 0xFF] = val;
+            }
+            return;
+        case Handler::HIGH:
+            break;
     }
-
-    IO* handler = io_registers[addr & 0xFF];
-    if(handler) {
-        handler->write(addr, val);
+    uint8_t reg = addr & 0xFF;
+    if(write_hooks[reg]) {
+        io_hooks[reg]->write(addr, val);
     } else {
-        fallback[addr] = val;
+        high[reg] = val;
     }
-}
\ No newline at end of file
+}
@@ -1,31 +1,10 @@
-#include <iostream>
 #include "Memory/SerialPort.h"
 #include "Memory/MMU.h"
 
-uint8_t SerialPort::read(uint16_t addr) {
-    switch(addr) {
-        case 0xFF01: return serial[0];
-        case 0xFF02: return serial[1];
-        default: return 0xFF;
-    }
-}
-
-void SerialPort::write(uint16_t addr, uint8_t val){
-    switch(addr) {
-        case 0xFF01: 
-            serial[0] = val;
-            break;
-        case 0xFF02: 
-            serial[1] = val;
-            break;
-        default: break;
-    }
-}
-
 SerialPort::SerialPort(MMU& mmu)
+    :data{mmu.io_register(START)},
+     control{mmu.io_register(END)}
     {
-        mmu.map_io_region(START, END, this);
-        
-        serial[0] = 0x00;
-        serial[1] = 0x7E;
-    }
\ No newline at end of file
+        data = 0x00;
+        control = 0x7E;
+    }
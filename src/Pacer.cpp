@@ -0,0 +1,134 @@
+#include "Pacer.h"
+#include <thread>
+#include <algorithm>
+
+namespace {
+    Pacer::Clock::duration period(double hz) {
+        return std::chrono::duration_cast<Pacer::Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+    }
+}
+
+Pacer::Pacer()
+    :display_period{period(60.0)}
+    {
+        auto now = Clock::now();
+        deadline = frame_start = window_start = next_draw = now;
+    }
+
+void Pacer::set_speed(double multiplier) {
+    speed = (multiplier > 0) ? multiplier : 0;
+}
+
+void Pacer::set_display_rate(double hz) {
+    display_period = period(hz);
+}
+
+void Pacer::set_auto_skip(bool on) {
+    auto_skip = on;
+    skip = calm = 0;
+}
+
+void Pacer::clear_histograms() {
+    drawn_hist.clear();
+    skipped_hist.clear();
+}
+
+bool Pacer::draw_next() {
+    frame_start = Clock::now();
+    //at up to real speed every frame is shown; faster than the display,
+    //only the frames that fall on a new refresh. the slack keeps timing
+    //jitter from dropping frames when both rates are about the same
+    drawing = frame_start + display_period / 4 >= next_draw && undrawn >= skip;
+    if(drawing) {
+        next_draw = std::max(next_draw, frame_start) + display_period;
+        undrawn = 0;
+    } else {
+        undrawn++;
+    }
+    return drawing;
+}
+
+void Pacer::frame_done() {
+    auto now = Clock::now();
+    auto cost = now - frame_start;
+    busy += cost;
+    frames++;
+    drawn += drawing;
+
+    //running averages over about the last 16 frames of each kind
+    double taken = std::chrono::duration<double>(cost).count();
+    double& average = drawing ? drawn_cost : skipped_cost;
+    average = (average > 0) ? average + (taken - average) / 16 : taken;
+    (drawing ? drawn_hist : skipped_hist).add(cost);
+
+    if(!turbo && speed > 0) {
+        auto frame_period = period(GB_FPS * speed);
+        deadline += frame_period;
+        if(auto_skip) {
+            adapt(now - deadline, frame_period);
+        }
+        if(now - deadline > MAX_LAG) {
+            //too far behind to catch up; carry on from here
+            deadline = now;
+        }
+        wait_until(deadline);
+    } else {
+        //nothing to keep up with
+        deadline = now;
+        skip = calm = 0;
+    }
+
+    now = Clock::now();
+    auto elapsed = now - window_start;
+    if(elapsed >= std::chrono::seconds(1)) {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        last_report.fps = frames / seconds;
+        last_report.speed = last_report.fps / GB_FPS;
+        last_report.load = std::chrono::duration<double>(busy).count() / seconds;
+        last_report.shown = drawn / seconds;
+        last_report.skip = skip;
+        window_start = now;
+        busy = Clock::duration{0};
+        frames = drawn = 0;
+    }
+}
+
+void Pacer::adapt(Clock::duration late, Clock::duration frame_period) {
+    settled++;
+    if(undrawn < skip) {
+        //a drawn frame can take longer than a period by itself; only the
+        //whole cycle up to the next drawn frame has to be on time
+        return;
+    }
+    if(late > Clock::duration{0}) {
+        //behind; draw less often, unless the last raise is still settling
+        calm = 0;
+        if(skip < max_skip && settled > RAISE_CYCLES * (skip + 1)) {
+            skip++;
+            settled = 0;
+        }
+        return;
+    }
+    if(skip == 0) {
+        return;
+    }
+    //would one drawn frame in every skip frames, rather than skip + 1,
+    //still leave some headroom?
+    double budget = std::chrono::duration<double>(frame_period).count() * RECOVER_LOAD;
+    double fewer = (drawn_cost + (skip - 1) * skipped_cost) / skip;
+    calm = (fewer < budget) ? calm + skip + 1 : 0;
+    if(calm >= RECOVER_FRAMES) {
+        skip--;
+        calm = 0;
+    }
+}
+
+void Pacer::wait_until(Clock::time_point t) const {
+    //sleep most of the way, then spin so oversleeping never costs a frame
+    if(t - Clock::now() > SPIN) {
+        std::this_thread::sleep_until(t - SPIN);
+    }
+    while(Clock::now() < t) {
+        std::this_thread::yield();
+    }
+}
@@ -2,7 +2,9 @@
 #include "Memory/MMU.h"
 #include "Memory/InterruptController.h"  
 #include "Memory/Bus.h"
+#include "Profiler.h"
 #include <iostream>
+#include <array>
 
 enum TimerAddress {
     DIV  = 0xFF04,
@@ -12,64 +14,105 @@ enum TimerAddress {
 };
 
 constexpr unsigned long CLOCK_SPEED = 4194304;
-uint8_t frequency_bit(uint8_t control_reg);
+constexpr uint16_t DIV_AT_BOOT = 0x18;
+
+//divider bit selected by the low bits of TAC
+constexpr std::array<uint8_t, 4> FREQUENCY_BIT = {9, 3, 5, 7};
+inline unsigned long increment_period(uint8_t control_reg) {
+    //t-cycles between falling edges of the selected bit
+    return 2ul << FREQUENCY_BIT[control_reg & 0x03];
+}
 
 Timer::Timer(Bus& bus, MMU& mmu, InterruptController& int_controller)
-    :div{0x18},
-     counter{0x00},
-     modulo{0x00},
-     control{0xF8},
-     increment_trigger{},
-     ic{int_controller}
+    :div_origin{0ul - DIV_AT_BOOT},
+     counter{mmu.io_register(TIMA)},
+     modulo{mmu.io_register(TMA)},
+     control{mmu.io_register(TAC)},
+     ic{int_controller},
+     bus{bus}
     {
-        mmu.map_io_region(START, END, this);
+        counter = 0x00;
+        modulo  = 0x00;
+        control = 0xF8;
+        mmu.hook_io_read(DIV, this);
+        mmu.hook_io_write(DIV, this);
+        mmu.hook_io_write(TAC, this);
         bus.connect(*this);
     }
+
+unsigned long Timer::now() const {
+    return bus.get_cycles() * 4;
+}
+
+bool Timer::increment_signal(uint8_t control_reg, uint16_t div) const {
+    return (control_reg & 0x04) && ((div >> FREQUENCY_BIT[control_reg & 0x03]) & 1);
+}
     
 uint8_t Timer::read(uint16_t addr) {
     switch(addr) {
-        case DIV : return static_cast<uint8_t>(div >> 8);
-        case TIMA: return counter;
-        case TMA : return modulo;
-        case TAC : return control;
+        case DIV : return static_cast<uint8_t>(divider(now()) >> 8);
 
         default: return 0xFF;
     }
 }
 
 void Timer::write(uint16_t addr, uint8_t val) {
+    //the bus syncs the timer before any access, so tima is current here
+    uint16_t div = divider(now());
     switch(addr) {
-        case DIV : div = 0;         break;
-        case TIMA: counter = val;   break;
-        case TMA : modulo = val;    break;
-        case TAC : control = val;   break; 
+        case DIV :
+            //resetting the divider drops the selected bit
+            if(increment_signal(control, div)) {
+                increment(1);
+            }
+            div_origin = now();
+            break;
+        case TAC :
+            //disabling the timer or selecting a low bit looks like a falling edge
+            if(increment_signal(control, div) && !increment_signal(val, div)) {
+                increment(1);
+            }
+            control = val;
+            break; 
 
         default: break;
     }
 }
 
-void Timer::tick() {
-    uint16_t old_div = div;  // Keep incrementing every cycle
-    div++;
-
-    bool old_inc = (old_div >> frequency_bit(control)) & 1;
-    bool new_inc = (div >> frequency_bit(control)) & 1;
-
-    if( enabled() && (old_inc && !new_inc) ) {
-        counter++;
-        if(counter == 0) {
-            counter = modulo;
-            ic.request(Interrupt::TIMER);
+void Timer::increment(unsigned long times) {
+    while(times > 0) {
+        unsigned long room = 0x100 - counter;
+        if(times < room) {
+            counter += times;
+            break;
         }
+        times -= room;
+        counter = modulo;
+        ic.request(Interrupt::TIMER);
+    }
+}
+
+void Timer::sync() {
+    PROFILE_ZONE(TIMER);
+    unsigned long from = synced * 4;
+    unsigned long to = now();
+    if(enabled()) {
+        //tima increments whenever the divider crosses a multiple of the period
+        unsigned long period = increment_period(control);
+        increment((to - div_origin) / period - (from - div_origin) / period);
     }
+    synced = bus.get_cycles();
+    reschedule();
 }
 
-uint8_t frequency_bit(uint8_t control_reg) {
-    switch(control_reg & 0x03) {
-        case 0 : return 9;
-        case 1 : return 3;
-        case 2 : return 5;
-        case 3 : return 7;
-        default: return 0;
+void Timer::reschedule() {
+    if(!enabled()) {
+        bus.cancel(Event::TIMER);
+        return;
     }
-}
\ No newline at end of file
+    unsigned long period = increment_period(control);
+    //t-cycles from the next one until the increment that overflows tima
+    unsigned long first_edge = period - (divider(synced * 4) % period) - 1;
+    unsigned long overflow = first_edge + (0xFF - counter) * period;
+    bus.schedule(Event::TIMER, synced + overflow / 4 + 1);
+}
@@ -1,37 +1,123 @@
 #include "Console.h"
+#include "Pacer.h"
+#include "Graphics/SdlLCD.h"
+#include "Graphics/TripleBuffer.h"
+#include "Control/SdlInputHandler.h"
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <exception>
 
-constexpr unsigned long FRAME_CYCLES = 17556;
+//usage: main <cart> [speed] [run ahead frames]
+//speed is a multiple of the game boy's frame rate, 0 for uncapped
+//run ahead shows the game that many frames on from where it is, hiding
+//as many frames of input lag, at that many more frames of work each
+//hold tab for turbo
+//running times of drawn and undrawn frames are printed on exit
+
+namespace {
+    void print_times(const char* name, const Pacer::Histogram& times) {
+        auto ms = [&](double share) {
+            return std::chrono::duration<double, std::milli>(times.percentile(share)).count();
+        };
+        std::cout << std::fixed << std::setprecision(2) << name << ": " << times.count() << " frames, "
+                  << "50% " << ms(0.5) << " ms, 90% " << ms(0.9) << " ms, 99% " << ms(0.99) << " ms\n";
+    }
+}
 
 int main(int argc, char* argv[]) {
-    Console gb;
+    auto display = std::make_unique<SdlLCD>(3);
+    SdlLCD* window = display.get();
+    auto keyboard = std::make_unique<SdlInputHandler>();
+    SdlInputHandler* keys = keyboard.get();
+    Console gb{std::move(display), std::move(keyboard)};
 
     std::string cart = argv[1];
     std::string filename = "../ROM/" + cart + ".gb";
 
     gb.rom.load(filename);
 
-    SDL_Event e;
-    bool quit = false;
+    //the console runs on its own thread and hands frames to this one, so
+    //vsync no longer paces the loop
+    Pacer pacer;
+    pacer.set_auto_skip(true);
+    if(argc > 2) {
+        pacer.set_speed(std::stod(argv[2]));
+    }
+    unsigned int ahead = (argc > 3) ? std::stoul(argv[3]) : 0;
+    SDL_DisplayMode mode;
+    if(SDL_GetCurrentDisplayMode(0, &mode) == 0 && mode.refresh_rate > 0) {
+        pacer.set_display_rate(mode.refresh_rate);
+    }
 
-    unsigned long next_frame_target = FRAME_CYCLES;
+    std::atomic<bool> quit{false};
+    std::atomic<bool> turbo{false};
+    TripleBuffer<Pacer::Report> reports;
+    std::exception_ptr failure;
 
-    while(!quit) {
-        while(gb.bus.get_cycles() < next_frame_target) {
-            gb.cpu.tick();
-        }
+    std::thread emulation{[&] {
+        try {
+            while(!quit) {
+                pacer.set_turbo(turbo);
+                gb.run_ahead(ahead, pacer.draw_next());
 
-        next_frame_target += FRAME_CYCLES;
+                gb.jp.read_input();
+                gb.display->draw_frame();
 
-        gb.jp.read_input();
-        gb.display.draw_frame();
+                pacer.frame_done();
 
+                reports.back_slot() = pacer.report();
+                reports.publish();
+            }
+        } catch(...) {
+            failure = std::current_exception();
+            quit = true;
+        }
+    }};
+
+    //SDL wants its window, renderer and events on the main thread
+    SDL_Event e;
+    double reported = 0;
+
+    while(!quit) {
         while(SDL_PollEvent(&e)) {
             if(e.type == SDL_QUIT) {
                 quit = true;
             }
+            if((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && e.key.keysym.scancode == SDL_SCANCODE_TAB) {
+                turbo = (e.type == SDL_KEYDOWN);
+            }
+        }
+        keys->sample();
+
+        if(!window->present()) {
+            //nothing new to show yet
+            SDL_Delay(1);
+        }
+
+        if(reports.take() && reports.front_slot().fps != reported) {
+            //a new report came in
+            const Pacer::Report& report = reports.front_slot();
+            reported = report.fps;
+            std::ostringstream title;
+            title << std::fixed << std::setprecision(2) << "gb5 - " << report.speed << "x, "
+                  << std::setprecision(0) << report.load * 100 << "% load";
+            if(report.skip > 0) {
+                title << ", drawing 1 in " << report.skip + 1;
+            }
+            window->set_title(title.str());
         }
     }
+    emulation.join();
+    if(failure) {
+        std::rethrow_exception(failure);
+    }
+
+    print_times("drawn", pacer.drawn_times());
+    print_times("skipped", pacer.skipped_times());
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,118 @@
+#include "Console.h"
+#include "Profiler.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+//headless throughput benchmark
+//usage: bench [rom path] [frames] [cached|interpreter|jit] [fifo|scanline]
+//             [argb8888|rgb565|shade|2bpp] [draw every n frames]
+//runs the rom for throughput numbers, then, if the core was built with
+//GB5_PROFILE, runs it again under the sampling profiler to split wall time
+//between subsystems
+
+constexpr double GB_FPS = 4194304.0 / (Console::FRAME_CYCLES * 4);
+
+struct PassResult {
+    double seconds;
+    unsigned long m_cycles;
+};
+
+const struct {
+    const char* name;
+    LCD::Format format;
+} FORMATS[] = {
+    {"argb8888", LCD::Format::ARGB8888},
+    {"rgb565", LCD::Format::RGB565},
+    {"shade", LCD::Format::SHADE},
+    {"2bpp", LCD::Format::SHADE_2BPP},
+};
+
+PassResult run_pass(const std::string& filename, unsigned long frames, CPU::Engine engine,
+                    PPU::Renderer renderer, LCD::Format format, unsigned long draw_every, bool profile) {
+    Console gb;
+    gb.rom.load(filename);
+    gb.cpu.set_engine(engine);
+    gb.ppu.set_renderer(renderer);
+    gb.display->set_format(format);
+
+    if(profile && !Profiler::start()) {
+        std::cerr << "profiler: could not start sampling timer\n";
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i = 0; i < frames; ++i) {
+        gb.run_frame((i + 1) % draw_every == 0);
+        gb.jp.read_input();
+        gb.display->draw_frame();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if(profile) {
+        Profiler::stop();
+    }
+    return {std::chrono::duration<double>(end - start).count(), gb.bus.get_cycles()};
+}
+
+int main(int argc, char* argv[]) {
+    std::string filename = (argc > 1) ? argv[1] : "ROM/test.gb";
+    unsigned long frames = (argc > 2) ? std::stoul(argv[2]) : 3600;
+    std::string engine_name = (argc > 3) ? argv[3] : "cached";
+    if(engine_name != "cached" && engine_name != "interpreter" && engine_name != "jit") {
+        std::cerr << "unknown cpu engine: " << engine_name << '\n';
+        return 1;
+    }
+    CPU::Engine engine = (engine_name == "interpreter") ? CPU::Engine::INTERPRETER
+                       : (engine_name == "jit") ? CPU::Engine::JIT : CPU::Engine::CACHED;
+    std::string renderer_name = (argc > 4) ? argv[4] : "fifo";
+    if(renderer_name != "fifo" && renderer_name != "scanline") {
+        std::cerr << "unknown renderer: " << renderer_name << '\n';
+        return 1;
+    }
+    PPU::Renderer renderer = (renderer_name == "scanline") ? PPU::Renderer::SCANLINE : PPU::Renderer::FIFO;
+    std::string format_name = (argc > 5) ? argv[5] : "argb8888";
+    auto format = std::find_if(std::begin(FORMATS), std::end(FORMATS),
+                               [&](const auto& f) {return format_name == f.name;});
+    if(format == std::end(FORMATS)) {
+        std::cerr << "unknown pixel format: " << format_name << '\n';
+        return 1;
+    }
+    unsigned long draw_every = (argc > 6) ? std::stoul(argv[6]) : 1;
+    if(draw_every == 0) {
+        std::cerr << "draw every n frames needs n >= 1\n";
+        return 1;
+    }
+
+    PassResult clean = run_pass(filename, frames, engine, renderer, format->format, draw_every, false);
+
+    double fps = frames / clean.seconds;
+    std::cout << std::fixed << std::setprecision(2)
+              << "rom:         " << filename << '\n'
+              << "frames:      " << frames << '\n'
+              << "cpu engine:  " << engine_name << '\n'
+              << "renderer:    " << renderer_name << '\n'
+              << "format:      " << format_name << " (" << LCD::frame_bytes(format->format) << " bytes per frame)\n"
+              << "drawn:       every " << draw_every << (draw_every == 1 ? " frame\n" : " frames\n")
+              << "seconds:     " << clean.seconds << '\n'
+              << "fps:         " << fps << " (" << fps / GB_FPS << "x realtime)\n"
+              << "m-cycles/s:  " << clean.m_cycles / clean.seconds / 1e6 << "M\n";
+
+#if defined(GB5_PROFILE) && defined(GB5_PROFILER_SAMPLING)
+    PassResult profiled = run_pass(filename, frames, engine, renderer, format->format, draw_every, true);
+
+    unsigned long total = 0;
+    for(int i = 0; i < Profiler::ZONE_COUNT; ++i) total += Profiler::samples[i];
+    std::cout << "profiled:    " << profiled.seconds << "s, "
+              << total << " samples (exclusive time per subsystem)\n";
+    for(int i = 0; i < Profiler::ZONE_COUNT; ++i) {
+        auto zone = static_cast<Profiler::Zone>(i);
+        double share = total ? 100.0 * Profiler::samples[i] / total : 0.0;
+        std::cout << "  " << std::left << std::setw(7) << Profiler::zone_name(zone)
+                  << std::right << std::setw(6) << share << "%  "
+                  << std::setw(8) << profiled.seconds * share / 100.0 << "s\n";
+    }
+#else
+    std::cout << "profiled:    unavailable (core built without GB5_PROFILE)\n";
+#endif
+    return 0;
+}
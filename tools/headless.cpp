@@ -0,0 +1,56 @@
+#include "Console.h"
+#include <iostream>
+#include <string>
+#include <chrono>
+
+//headless batch runner
+//usage: headless <rom path> [frames] [argb8888|rgb565|shade|2bpp]
+//runs the rom without a display and prints a checksum of the last frame
+
+uint32_t frame_checksum(const LCD& display) {
+    //FNV-1a over the frame buffer bytes
+    uint32_t hash = 0x811C9DC5;
+    const uint8_t* bytes = display.frame();
+    for(size_t i = 0; i < display.frame_bytes(); ++i) {
+        hash = (hash ^ bytes[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <rom> [frames] [argb8888|rgb565|shade|2bpp]\n";
+        return 1;
+    }
+    std::string filename = argv[1];
+    unsigned long frames = (argc > 2) ? std::stoul(argv[2]) : 600;
+    std::string format = (argc > 3) ? argv[3] : "argb8888";
+
+    Console gb;
+    if(format == "rgb565") {
+        gb.display->set_format(LCD::Format::RGB565);
+    } else if(format == "shade") {
+        gb.display->set_format(LCD::Format::SHADE);
+    } else if(format == "2bpp") {
+        gb.display->set_format(LCD::Format::SHADE_2BPP);
+    } else if(format != "argb8888") {
+        std::cerr << "unknown pixel format: " << format << '\n';
+        return 1;
+    }
+    gb.rom.load(filename);
+
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i = 0; i < frames; ++i) {
+        gb.run_frame();
+        gb.jp.read_input();
+        gb.display->draw_frame();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "frames:   " << frames << '\n'
+              << "seconds:  " << seconds << '\n'
+              << "fps:      " << frames / seconds << '\n'
+              << "checksum: " << std::hex << frame_checksum(*gb.display) << std::dec << '\n';
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "Console.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <filesystem>
+
+//block engine regression check
+//usage: pollcheck [frames] [rom path]
+//builds a rom that turns the lcd off and spins on P1 until a button is
+//down, then presses A in a range of frames, with the loop shifted by a
+//few leading nops. this catches idle loop skips that outlive input read
+//between frames. then runs a rom built to hammer the loads, stores and
+//stack ops the jit does straight through the page tables, including
+//16-bit accesses across a page, and the given rom (ROM/test.gb by
+//default) with the buttons changing every few frames. the cached and jit
+//engines have to match the interpreter at the end of every frame
+
+struct FrameEnd {
+    unsigned long cycles;
+    uint16_t pc, sp;
+    std::array<uint8_t, 8> regs;
+    std::vector<uint8_t> wram;
+    bool operator==(const FrameEnd&) const = default;
+};
+
+std::vector<uint8_t> polling_rom(int nops) {
+    std::vector<uint8_t> rom(0x8000, 0x00);
+    //entry: nop; jp $0150
+    const uint8_t entry[] = {0x00, 0xC3, 0x50, 0x01};
+    std::copy(std::begin(entry), std::end(entry), rom.begin() + 0x100);
+    std::vector<uint8_t> code = {
+        0xAF,               //xor a
+        0xE0, 0x40,         //ldh [LCDC],a      lcd off
+        0x3E, 0x10,         //ld a,$10
+        0xE0, 0x00,         //ldh [P1],a        select the buttons
+    };
+    code.insert(code.end(), nops, 0x00);
+    const uint8_t poll[] = {
+        0xF0, 0x00,         //loop: ldh a,[P1]
+        0xE6, 0x0F,         //and $0F
+        0xFE, 0x0F,         //cp $0F
+        0x28, 0xF8,         //jr z,loop
+        0x3E, 0x01,         //ld a,$01
+        0xEA, 0x00, 0xC0,   //ld [$C000],a
+        0x18, 0xFE,         //jr @
+    };
+    code.insert(code.end(), std::begin(poll), std::end(poll));
+    std::copy(code.begin(), code.end(), rom.begin() + 0x150);
+    return rom;
+}
+
+std::vector<uint8_t> memory_rom() {
+    std::vector<uint8_t> rom(0x8000, 0x00);
+    //entry: nop; jp $0150
+    const uint8_t entry[] = {0x00, 0xC3, 0x50, 0x01};
+    std::copy(std::begin(entry), std::end(entry), rom.begin() + 0x100);
+    const uint8_t code[] = {
+        0xF3,               //di
+        0x31, 0x03, 0xC9,   //ld sp,$C903       push hl crosses a page
+        0x21, 0xF8, 0xC0,   //ld hl,$C0F8
+        0x11, 0x23, 0x01,   //ld de,$0123
+        0x01, 0x67, 0x45,   //ld bc,$4567
+        0x7E,               //loop: ld a,[hl]
+        0x83,               //add a,e
+        0x22,               //ld [hl+],a
+        0x34,               //inc [hl]
+        0xAE,               //xor [hl]
+        0x32,               //ld [hl-],a
+        0x72,               //ld [hl],d
+        0xD5,               //push de
+        0xE5,               //push hl
+        0xCD, 0x83, 0x01,   //call sub
+        0xE1,               //pop hl
+        0xF1,               //pop af            low bits of f have to drop
+        0xF5,               //push af
+        0xC1,               //pop bc
+        0xEA, 0x00, 0xC1,   //ld [$C100],a
+        0xFA, 0xFF, 0xC0,   //ld a,[$C0FF]
+        0x80,               //add a,b
+        0xDC, 0x83, 0x01,   //call c,sub
+        0x13,               //inc de
+        0x5F,               //ld e,a
+        0x23,               //inc hl
+        0x7C,               //ld a,h
+        0xFE, 0xC2,         //cp $C2
+        0x20, 0xDE,         //jr nz,loop
+        0x26, 0xC0,         //ld h,$C0
+        0x18, 0xDA,         //jr loop
+        0x73,               //sub: ld [hl],e
+        0xD0,               //ret nc
+        0x35,               //dec [hl]
+        0xC9,               //ret
+    };
+    std::copy(std::begin(code), std::end(code), rom.begin() + 0x150);
+    return rom;
+}
+
+//press_frame presses A from that frame on; without one the buttons
+//change every few frames
+std::vector<FrameEnd> run(const std::string& filename, CPU::Engine engine, unsigned long frames,
+                          long press_frame = -1) {
+    auto input = std::make_unique<HeadlessInput>();
+    HeadlessInput* buttons = input.get();
+    Console gb{std::make_unique<HeadlessLCD>(), std::move(input)};
+    gb.rom.load(filename);
+    gb.cpu.set_engine(engine);
+
+    std::vector<FrameEnd> ends;
+    uint8_t pressed = 0;
+    for(unsigned long i = 0; i < frames; ++i) {
+        if(press_frame < 0 && i % 8 == 0) {
+            pressed = pressed * 5 + 3;
+            buttons->set_buttons(pressed);
+        } else if(static_cast<long>(i) == press_frame) {
+            buttons->press(InputHandler::Mapping::A);
+        }
+        gb.jp.read_input();
+        gb.run_frame();
+        CPU& cpu = gb.cpu;
+        FrameEnd end{gb.bus.get_cycles(), cpu.pc, cpu.sp,
+                     {cpu.A, cpu.flags(), cpu.B, cpu.C, cpu.D, cpu.E, cpu.H, cpu.L}, {}};
+        for(int addr = 0; addr < 0x2000; ++addr) {
+            end.wram.push_back(gb.wram[addr]);
+        }
+        ends.push_back(std::move(end));
+    }
+    return ends;
+}
+
+struct Engine {
+    const char* name;
+    CPU::Engine engine;
+};
+const Engine engines[] = {
+    {"cached", CPU::Engine::CACHED},
+    {"jit", CPU::Engine::JIT},
+};
+
+//runs that part ways with the interpreter, reported under the given label
+int compare(const std::string& filename, const std::string& label, unsigned long frames,
+            long press_frame = -1) {
+    int failures = 0;
+    std::vector<FrameEnd> expected = run(filename, CPU::Engine::INTERPRETER, frames, press_frame);
+    for(const auto& e : engines) {
+        std::vector<FrameEnd> actual = run(filename, e.engine, frames, press_frame);
+        for(unsigned long i = 0; i < frames; ++i) {
+            if(!(actual[i] == expected[i])) {
+                std::cerr << e.name << ", " << label << ": frame " << i << " ends at pc "
+                          << std::hex << actual[i].pc << ", interpreter at " << expected[i].pc
+                          << std::dec << '\n';
+                failures++;
+                break;
+            }
+        }
+    }
+    return failures;
+}
+
+void write_rom(const std::string& filename, const std::vector<uint8_t>& rom) {
+    std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(rom.data()), rom.size());
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long frames = (argc > 1) ? std::stoul(argv[1]) : 12;
+    std::string game = (argc > 2) ? argv[2] : "ROM/test.gb";
+    std::string filename = (std::filesystem::temp_directory_path() / "gb5_pollcheck.gb").string();
+
+    int failures = 0;
+    for(int nops = 0; nops <= 4; ++nops) {
+        write_rom(filename, polling_rom(nops));
+        for(unsigned long press = 1; press + 1 < frames; ++press) {
+            std::string label = std::to_string(nops) + " nops, A from frame " + std::to_string(press);
+            failures += compare(filename, label, frames, press);
+        }
+    }
+    //long enough for the blocks to get hot and translated
+    unsigned long long_frames = std::max<unsigned long>(frames, 120);
+    write_rom(filename, memory_rom());
+    failures += compare(filename, "memory ops", long_frames);
+    std::filesystem::remove(filename);
+    failures += compare(game, game, long_frames);
+
+    if(failures) {
+        std::cerr << failures << " runs differ from the interpreter\n";
+        return 1;
+    }
+    std::cout << "all engines match the interpreter\n";
+    return 0;
+}
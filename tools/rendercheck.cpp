@@ -0,0 +1,164 @@
+#include "Console.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+//scanline renderer timing check
+//usage: rendercheck [frames] [rom path]
+//the scanline renderer has to keep every mode 3 exactly as long as the
+//fifo's, so a game can't tell which one draws it. runs a rom that hammers
+//lcdc, scx and wx in the middle of lines full of sprites and the window,
+//logging stat and ly into wram, and turns the lcd off and on now and then.
+//the loop is shifted by a few leading nops. then runs the given rom
+//(ROM/test.gb by default) with the buttons changing every few frames. the
+//two renderers have to end every frame with the same cpu, wram and ppu
+//registers
+
+struct FrameEnd {
+    unsigned long cycles;
+    uint16_t pc, sp;
+    uint8_t stat, ly;
+    std::vector<uint8_t> wram;
+    bool operator==(const FrameEnd&) const = default;
+};
+
+std::vector<uint8_t> register_rom(int nops) {
+    std::vector<uint8_t> rom(0x8000, 0x00);
+    //entry: nop; jp $0150
+    const uint8_t entry[] = {0x00, 0xC3, 0x50, 0x01};
+    std::copy(std::begin(entry), std::end(entry), rom.begin() + 0x100);
+    std::vector<uint8_t> code = {
+        0xF3,               //di
+        0xAF,               //xor a
+        0xE0, 0x40,         //ldh [LCDC],a      lcd off
+        0x21, 0x00, 0xFE,   //ld hl,$FE00
+        0x0E, 0x00,         //ld c,0
+        0x79,               //oam: ld a,c
+        0x87, 0x87,         //add a,a; add a,a
+        0xC6, 0x10,         //add a,$10
+        0x22,               //ld [hl+],a        y = 16 + 4i
+        0x79,               //ld a,c
+        0x87, 0x87,         //add a,a; add a,a
+        0xC6, 0x08,         //add a,$08
+        0x22,               //ld [hl+],a        x = 8 + 4i
+        0x79, 0x22,         //ld a,c; ld [hl+],a
+        0xAF, 0x22,         //xor a; ld [hl+],a
+        0x0C,               //inc c
+        0x79,               //ld a,c
+        0xFE, 0x28,         //cp 40
+        0x20, 0xEA,         //jr nz,oam
+        0x3E, 0x28,         //ld a,40
+        0xE0, 0x4A,         //ldh [WY],a
+        0x3E, 0x50,         //ld a,80
+        0xE0, 0x4B,         //ldh [WX],a
+        0x3E, 0xB3,         //ld a,$B3
+        0xE0, 0x40,         //ldh [LCDC],a      lcd, window and sprites on
+    };
+    code.insert(code.end(), nops, 0x00);
+    const uint8_t loop[] = {
+        0x21, 0x00, 0xC0,   //ld hl,$C000
+        0xF0, 0x41,         //loop: ldh a,[STAT]
+        0x22,               //ld [hl+],a
+        0xF0, 0x44,         //ldh a,[LY]
+        0x22,               //ld [hl+],a
+        0xF0, 0x40,         //ldh a,[LCDC]
+        0xEE, 0x02,         //xor $02
+        0xE0, 0x40,         //ldh [LCDC],a      sprites on/off
+        0x0C,               //inc c
+        0x79,               //ld a,c
+        0xE0, 0x43,         //ldh [SCX],a
+        0xE6, 0x3F,         //and $3F
+        0xC6, 0x40,         //add a,$40
+        0xE0, 0x4B,         //ldh [WX],a
+        0x7D,               //ld a,l
+        0xE6, 0x07,         //and $07
+        0x3C,               //inc a
+        0x3D,               //delay: dec a
+        0x20, 0xFD,         //jr nz,delay
+        0x7C,               //ld a,h
+        0xFE, 0xD0,         //cp $D0
+        0x20, 0xDE,         //jr nz,loop
+        0x26, 0xC0,         //ld h,$C0
+        0xF0, 0x40,         //ldh a,[LCDC]
+        0xE6, 0x7F,         //and $7F
+        0xE0, 0x40,         //ldh [LCDC],a      lcd off
+        0x00, 0x00,         //nop; nop
+        0xF6, 0x80,         //or $80
+        0xE0, 0x40,         //ldh [LCDC],a      and back on
+        0x18, 0xCE,         //jr loop
+    };
+    code.insert(code.end(), std::begin(loop), std::end(loop));
+    std::copy(code.begin(), code.end(), rom.begin() + 0x150);
+    return rom;
+}
+
+std::vector<FrameEnd> run(const std::string& filename, PPU::Renderer renderer, unsigned long frames) {
+    auto input = std::make_unique<HeadlessInput>();
+    HeadlessInput* buttons = input.get();
+    Console gb{std::make_unique<HeadlessLCD>(), std::move(input)};
+    gb.rom.load(filename);
+    gb.ppu.set_renderer(renderer);
+
+    std::vector<FrameEnd> ends;
+    uint8_t pressed = 0;
+    for(unsigned long i = 0; i < frames; ++i) {
+        if(i % 8 == 0) {
+            pressed = pressed * 5 + 3;
+            buttons->set_buttons(pressed);
+        }
+        gb.jp.read_input();
+        gb.run_frame();
+        FrameEnd end{gb.bus.get_cycles(), gb.cpu.pc, gb.cpu.sp,
+                     gb.mmu.read(Space::STAT), gb.mmu.read(Space::LY), {}};
+        for(int addr = 0; addr < 0x2000; ++addr) {
+            end.wram.push_back(gb.wram[addr]);
+        }
+        ends.push_back(std::move(end));
+    }
+    return ends;
+}
+
+//frame the two renderers first part ways on, -1 if they never do
+long first_difference(const std::string& filename, unsigned long frames) {
+    std::vector<FrameEnd> fifo = run(filename, PPU::Renderer::FIFO, frames);
+    std::vector<FrameEnd> scanline = run(filename, PPU::Renderer::SCANLINE, frames);
+    for(unsigned long i = 0; i < frames; ++i) {
+        if(!(fifo[i] == scanline[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long frames = (argc > 1) ? std::stoul(argv[1]) : 300;
+    std::string game = (argc > 2) ? argv[2] : "ROM/test.gb";
+    std::string filename = (std::filesystem::temp_directory_path() / "gb5_rendercheck.gb").string();
+
+    int failures = 0;
+    for(int nops = 0; nops <= 4; ++nops) {
+        std::vector<uint8_t> rom = register_rom(nops);
+        std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(rom.data()), rom.size());
+        long frame = first_difference(filename, frames);
+        if(frame >= 0) {
+            std::cerr << "register writes, " << nops << " nops: renderers part ways on frame " << frame << '\n';
+            failures++;
+        }
+    }
+    std::filesystem::remove(filename);
+
+    long frame = first_difference(game, frames);
+    if(frame >= 0) {
+        std::cerr << game << ": renderers part ways on frame " << frame << '\n';
+        failures++;
+    }
+
+    if(failures) {
+        std::cerr << failures << " runs differ between the renderers\n";
+        return 1;
+    }
+    std::cout << "scanline timing matches the fifo\n";
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "Console.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <memory>
+
+//snapshot save/restore benchmark
+//usage: statebench [rom path] [frames] [run ahead frames]
+//saves the console before every frame and restores it after, checks that
+//running the frame again ends where the first run did, and reports what
+//saving and restoring cost next to a frame. then compares plain frames
+//with run ahead frames
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//the parts of a snapshot that show whether two runs went the same way
+bool same_state(const Console::Snapshot& a, const Console::Snapshot& b) {
+    return a.bus.cycles == b.bus.cycles && a.cpu.pc == b.cpu.pc && a.cpu.sp == b.cpu.sp &&
+           a.wram == b.wram && a.mmu.high == b.mmu.high && a.rom.ram == b.rom.ram &&
+           a.ppu.vram == b.ppu.vram && a.ppu.oam == b.ppu.oam && a.ppu.line == b.ppu.line;
+}
+
+double frames_per_second(const std::string& filename, unsigned long frames, unsigned int ahead) {
+    Console gb;
+    gb.rom.load(filename);
+    auto start = Clock::now();
+    for(unsigned long i = 0; i < frames; ++i) {
+        gb.run_ahead(ahead);
+        gb.jp.read_input();
+        gb.display->draw_frame();
+    }
+    return frames / seconds_since(start);
+}
+
+int main(int argc, char* argv[]) {
+    std::string filename = (argc > 1) ? argv[1] : "ROM/test.gb";
+    unsigned long frames = (argc > 2) ? std::stoul(argv[2]) : 600;
+    unsigned int ahead = (argc > 3) ? std::stoul(argv[3]) : 1;
+
+    Console gb;
+    gb.rom.load(filename);
+    //snapshots are too big to keep on the stack
+    auto before = std::make_unique<Console::Snapshot>();
+    auto first = std::make_unique<Console::Snapshot>();
+    auto again = std::make_unique<Console::Snapshot>();
+
+    double save = 0, restore = 0, run = 0;
+    for(unsigned long i = 0; i < frames; ++i) {
+        auto start = Clock::now();
+        gb.save_state(*before);
+        save += seconds_since(start);
+
+        start = Clock::now();
+        gb.run_frame();
+        run += seconds_since(start);
+        gb.save_state(*first);
+
+        start = Clock::now();
+        gb.load_state(*before);
+        restore += seconds_since(start);
+
+        gb.run_frame();
+        gb.save_state(*again);
+        if(!same_state(*first, *again)) {
+            std::cerr << "frame " << i << " ran differently after a restore\n";
+            return 1;
+        }
+    }
+
+    double plain = frames_per_second(filename, frames, 0);
+    double run_ahead = frames_per_second(filename, frames, ahead);
+    std::cout << std::fixed << std::setprecision(2)
+              << "rom:         " << filename << '\n'
+              << "frames:      " << frames << '\n'
+              << "snapshot:    " << sizeof(Console::Snapshot) + before->rom.ram.size() << " bytes\n"
+              << "save:        " << save / frames * 1e6 << " us\n"
+              << "restore:     " << restore / frames * 1e6 << " us\n"
+              << "frame:       " << run / frames * 1e6 << " us\n"
+              << "plain:       " << plain << " fps\n"
+              << "run ahead " << ahead << ": " << run_ahead << " fps ("
+              << plain / run_ahead << "x the time per frame)\n";
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "Graphics/TileDecode.h"
+#include "Graphics/Tile.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+
+//tile row decoding microbenchmark
+//usage: tilebench [passes]
+//decodes all 384 tiles of a random VRAM image with Tile::get_pixel, the
+//scalar kernel and the dispatched kernel, checks they agree and reports
+//rows per second
+
+constexpr size_t TILES = 384;
+constexpr size_t ROWS = TILES * 8;
+
+using Decoder = void(*)(const uint8_t* planes, uint8_t* pixels, bool x_flip);
+
+void decode_get_pixel(const uint8_t* planes, uint8_t* pixels, bool x_flip) {
+    //the per-pixel loop the fetchers used before the tile cache
+    for(size_t t = 0; t < TILES; ++t) {
+        Tile tile{planes + 16*t};
+        for(uint8_t y = 0; y < 8; ++y) {
+            for(uint8_t x = 0; x < 8; ++x) {
+                pixels[64*t + 8*y + (x_flip ? x : 7 - x)] = tile.get_pixel(x, y);
+            }
+        }
+    }
+}
+void decode_scalar(const uint8_t* planes, uint8_t* pixels, bool x_flip) {
+    TileDecode::rows_scalar(planes, ROWS, pixels, x_flip);
+}
+void decode_dispatched(const uint8_t* planes, uint8_t* pixels, bool x_flip) {
+    TileDecode::rows(planes, ROWS, pixels, x_flip);
+}
+
+double rows_per_second(Decoder decode, const uint8_t* planes, uint8_t* pixels, unsigned long passes) {
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i = 0; i < passes; ++i) {
+        decode(planes, pixels, i & 1);
+        //keep the compiler from dropping passes whose output is overwritten
+        asm volatile("" : : "r"(pixels) : "memory");
+    }
+    auto end = std::chrono::steady_clock::now();
+    return ROWS * passes / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long passes = (argc > 1) ? std::stoul(argv[1]) : 20000;
+
+    std::vector<uint8_t> planes(ROWS * 2);
+    std::mt19937 rng{0x6B5};
+    for(auto& b : planes) b = static_cast<uint8_t>(rng());
+
+    std::vector<uint8_t> expected(ROWS * 8), actual(ROWS * 8);
+    for(bool flip : {false, true}) {
+        decode_get_pixel(planes.data(), expected.data(), flip);
+        for(Decoder decode : {decode_scalar, decode_dispatched}) {
+            decode(planes.data(), actual.data(), flip);
+            if(std::memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+                std::cerr << "kernel output differs from Tile::get_pixel\n";
+                return 1;
+            }
+        }
+    }
+
+    const struct {
+        const char* name;
+        Decoder decode;
+    } runs[] = {
+        {"get_pixel", decode_get_pixel},
+        {"scalar", decode_scalar},
+        {TileDecode::kernel_name(), decode_dispatched},
+    };
+    double base = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    for(const auto& run : runs) {
+        double rate = rows_per_second(run.decode, planes.data(), actual.data(), passes);
+        if(base == 0) base = rate;
+        std::cout << std::left << std::setw(10) << run.name << std::right
+                  << std::setw(10) << rate / 1e6 << "M rows/s  "
+                  << std::setw(5) << rate / base << "x\n";
+    }
+    return 0;
+}